@@ -0,0 +1,48 @@
+#pragma once
+
+/*
+ * Helpers shared by the benchmarks.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <time.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+static uint64_t bench_now_ns() {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/*
+ * CPU timestamp counter. Falls back to nanoseconds on other architectures.
+ */
+static uint64_t bench_cycles() {
+#if defined(__x86_64__) || defined(__i386__)
+	return __rdtsc();
+#else
+	return bench_now_ns();
+#endif
+}
+
+/*
+ * Cheap deterministic pseudo random numbers so runs are reproducible.
+ */
+static uint64_t bench_rand(uint64_t *state) {
+	uint64_t x = *state;
+	x ^= x << 13;
+	x ^= x >> 7;
+	x ^= x << 17;
+	return *state = x;
+}
+
+/*
+ * Print one result line. 'ns' is the total time spent on 'nop' operations.
+ */
+static void bench_report(const char *name, int n, uint64_t ns, int nop) {
+	printf("  %-28s n=%-9d %8.2f ms %8.2f ns/op\n", name, n, ns / 1e6, (double) ns / nop);
+}
@@ -0,0 +1,68 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "scom/arena.h"
+#include "scom/dict.h"
+#include "scom/vec.h"
+#include "bench.h"
+
+/*
+ * A link-like workload: for each of 'nfile' files, build a vec of n/nfile
+ * symbol names and put every name into a global dict keyed by a copy of the
+ * name. Everything dies at the end. Compare libc (vec_free/dict_free free
+ * each object) against an arena (arena_release drops the chunks).
+ *
+ * Usage: ./a.out [n] [nfile]
+ */
+
+static char *make_name(char *buf, uint64_t *state) {
+	snprintf(buf, 32, "sym_%llx", (unsigned long long) bench_rand(state));
+	return buf;
+}
+
+static void run(const char *name, int n, int nfile, bool use_arena) {
+	struct arena arena;
+	arena_init(&arena, 0);
+	struct allocator *alloc = use_arena ? &arena.base : NULL;
+	uint64_t state = 88172645463325252ULL;
+	char buf[32];
+
+	uint64_t start = bench_now_ns();
+	struct dict dict = dict_create_with_alloc(DICT_LINEAR, str_hash_fn, str_eq_fn, true, false, alloc);
+	struct vec files = vec_create(sizeof(struct vec));
+	for (int f = 0; f < nfile; ++f) {
+		struct vec syms = vec_create_with_alloc(sizeof(char*), alloc);
+		syms.should_free_each_item = true;
+		for (int i = 0; i < n / nfile; ++i) {
+			make_name(buf, &state);
+			char *sym = alloc_lenstrdup(alloc, buf, strlen(buf));
+			vec_append(&syms, &sym);
+			dict_put(&dict, alloc_lenstrdup(alloc, buf, strlen(buf)), sym);
+		}
+		vec_append(&files, &syms);
+	}
+	uint64_t build_ns = bench_now_ns() - start;
+
+	start = bench_now_ns();
+	if (use_arena) {
+		arena_release(&arena);
+	} else {
+		VEC_FOREACH(&files, struct vec, syms) {
+			vec_free(syms);
+		}
+		dict_free(&dict);
+	}
+	vec_free(&files);
+	uint64_t free_ns = bench_now_ns() - start;
+
+	printf("%s\n", name);
+	bench_report("build", n, build_ns, n);
+	bench_report("teardown", n, free_ns, n);
+}
+
+int main(int argc, char **argv) {
+	int n = argc >= 2 ? atoi(argv[1]) : 1000000;
+	int nfile = argc >= 3 ? atoi(argv[2]) : 1000;
+	run("libc", n, nfile, false);
+	run("arena", n, nfile, true);
+	return 0;
+}
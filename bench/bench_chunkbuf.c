@@ -0,0 +1,68 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+#include "scom/elf_writer.h"
+#include "bench.h"
+
+/*
+ * Build an 'mb' MB .text out of 4KB pieces in a struct str (realloc doubling)
+ * against a struct chunkbuf, and write it out as an ELF segment. Each
+ * variant runs in a child process so its peak RSS can be reported.
+ *
+ * Usage: ./a.out [mb]
+ */
+
+static void run(const char *name, size_t size, bool chunked) {
+	pid_t pid = fork();
+	CHECK(pid >= 0, "fork fail");
+	if (pid > 0) {
+		int status;
+		waitpid(pid, &status, 0);
+		CHECK(WIFEXITED(status) && WEXITSTATUS(status) == 0, "%s failed", name);
+		return;
+	}
+
+	char piece[4096];
+	memset(piece, 0x90, sizeof(piece));
+	struct str textstr = str_create(0);
+	struct chunkbuf textbuf = chunkbuf_create(0);
+	uint64_t start = bench_now_ns();
+	for (size_t off = 0; off < size; off += sizeof(piece)) {
+		if (chunked) {
+			chunkbuf_append(&textbuf, piece, sizeof(piece));
+		} else {
+			str_write_bytes(&textstr, piece, sizeof(piece));
+		}
+	}
+	uint64_t build_ns = bench_now_ns() - start;
+
+	start = bench_now_ns();
+	struct elf_writer writer = elfw_create();
+	if (chunked) {
+		elfw_create_chunked_segment(&writer, ".text", &textbuf, textbuf.len);
+	} else {
+		elfw_create_segment(&writer, ".text", &textstr, textstr.len);
+	}
+	elfw_write(&writer, "/tmp/bench_chunkbuf.elf");
+	uint64_t write_ns = bench_now_ns() - start;
+	elfw_free(&writer);
+	unlink("/tmp/bench_chunkbuf.elf");
+
+	struct rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+	int npiece = size / sizeof(piece);
+	printf("%s\n", name);
+	bench_report("build", npiece, build_ns, npiece);
+	bench_report("write", npiece, write_ns, npiece);
+	printf("  %-28s peak RSS %ld MB\n", "", usage.ru_maxrss / 1024);
+	exit(0);
+}
+
+int main(int argc, char **argv) {
+	size_t mb = argc >= 2 ? atoi(argv[1]) : 256;
+	run("str", mb << 20, false);
+	run("chunkbuf", mb << 20, true);
+	return 0;
+}
@@ -0,0 +1,110 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include "scom/concurrent_dict.h"
+#include "bench.h"
+
+/*
+ * Scaling of struct cdict against a struct dict behind one global mutex, from
+ * 1 to 64 threads. Each thread runs a read-mostly mix: 95% lookups of
+ * existing symbols and 5% put_if_absent of new ones.
+ *
+ * Usage: ./a.out [nkey] [nop_per_thread]
+ */
+
+enum {
+	MAX_THREAD = 64,
+};
+
+static int nkey, nop;
+static char **keys; // nkey existing keys followed by MAX_THREAD * nop new keys
+
+static struct cdict cd;
+static struct dict global_dict;
+static pthread_mutex_t global_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static void *cdict_worker(void *arg) {
+	intptr_t tid = (intptr_t) arg;
+	uint64_t rnd = tid + 1;
+	char **new_keys = keys + nkey + tid * nop;
+	int nnew = 0;
+	for (int i = 0; i < nop; ++i) {
+		uint64_t r = bench_rand(&rnd);
+		if (r % 100 < 5) {
+			cdict_put_if_absent(&cd, new_keys[nnew++], (void*) 1, NULL);
+		} else {
+			bool found = cdict_find(&cd, keys[r % nkey], NULL);
+			assert(found);
+		}
+	}
+	return NULL;
+}
+
+static void *locked_worker(void *arg) {
+	intptr_t tid = (intptr_t) arg;
+	uint64_t rnd = tid + 1;
+	char **new_keys = keys + nkey + tid * nop;
+	int nnew = 0;
+	for (int i = 0; i < nop; ++i) {
+		uint64_t r = bench_rand(&rnd);
+		pthread_mutex_lock(&global_lock);
+		if (r % 100 < 5) {
+			char *key = new_keys[nnew++];
+			if (!dict_find(&global_dict, key)) {
+				dict_put(&global_dict, key, (void*) 1);
+			}
+		} else {
+			struct dict_entry *entry = dict_find(&global_dict, keys[r % nkey]);
+			assert(entry);
+		}
+		pthread_mutex_unlock(&global_lock);
+	}
+	return NULL;
+}
+
+static uint64_t run_threads(int nthread, void *(*worker)(void*)) {
+	pthread_t threads[MAX_THREAD];
+	uint64_t start = bench_now_ns();
+	for (intptr_t t = 0; t < nthread; ++t) {
+		pthread_create(&threads[t], NULL, worker, (void*) t);
+	}
+	for (int t = 0; t < nthread; ++t) {
+		pthread_join(threads[t], NULL);
+	}
+	return bench_now_ns() - start;
+}
+
+int main(int argc, char **argv) {
+	nkey = argc >= 2 ? atoi(argv[1]) : 1000000;
+	nop = argc >= 3 ? atoi(argv[2]) : 1000000;
+	int nall = nkey + MAX_THREAD * nop;
+	keys = malloc(sizeof(char*) * nall);
+	char buf[64];
+	for (int i = 0; i < nall; ++i) {
+		snprintf(buf, sizeof(buf), "_ZN4scom6symbol%dEv", i);
+		keys[i] = strdup(buf);
+	}
+
+	printf("%d keys, %d ops per thread\n", nkey, nop);
+	printf("%8s %16s %16s\n", "threads", "cdict Mops/s", "mutex Mops/s");
+	for (int nthread = 1; nthread <= MAX_THREAD; nthread <<= 1) {
+		cd = cdict_create(str_hash_fn, str_eq_fn, 0, 6);
+		global_dict = dict_create(str_hash_fn, str_eq_fn, 0, 0);
+		for (int i = 0; i < nkey; ++i) {
+			cdict_put(&cd, keys[i], NULL);
+			dict_put(&global_dict, keys[i], NULL);
+		}
+		uint64_t cdict_ns = run_threads(nthread, cdict_worker);
+		uint64_t locked_ns = run_threads(nthread, locked_worker);
+		double total = (double) nthread * nop;
+		printf("%8d %16.2f %16.2f\n", nthread, total / cdict_ns * 1e3, total / locked_ns * 1e3);
+		cdict_free(&cd);
+		dict_free(&global_dict);
+	}
+
+	for (int i = 0; i < nall; ++i) {
+		free(keys[i]);
+	}
+	free(keys);
+	return 0;
+}
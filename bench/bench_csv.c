@@ -0,0 +1,55 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "scom/csv.h"
+#include "bench.h"
+
+/*
+ * Split a comma separated list of n symbol names with vec_create_from_csv
+ * (a lenstrdup per field) against the string view tokenizer, whole and fed
+ * in 64KB chunks. Build with -mavx2 to use 32 byte blocks.
+ *
+ * Usage: ./a.out [n]
+ */
+
+static void count_field(void *ctx, struct strview field) {
+	*(size_t*) ctx += field.len;
+}
+
+int main(int argc, char **argv) {
+	int n = argc >= 2 ? atoi(argv[1]) : 1000000;
+	uint64_t state = 88172645463325252ULL;
+	struct str csv = str_create(0);
+	char buf[64];
+	for (int i = 0; i < n; ++i) {
+		int len = snprintf(buf, sizeof(buf), "%s_sym_%llx,", i % 3 ? "" : " ", (unsigned long long) (bench_rand(&state) >> (bench_rand(&state) % 40)));
+		str_lenconcat(&csv, buf, len);
+	}
+	str_append(&csv, '\0');
+	printf("%d fields, %d bytes\n", n, csv.len);
+
+	uint64_t start = bench_now_ns();
+	struct vec copies = vec_create_from_csv(csv.buf);
+	bench_report("vec_create_from_csv", n, bench_now_ns() - start, n);
+	assert(copies.len == n);
+	vec_free(&copies);
+
+	start = bench_now_ns();
+	struct vec views = vec_create_views_from_csv(csv.buf);
+	bench_report("vec_create_views_from_csv", n, bench_now_ns() - start, n);
+	assert(views.len == n);
+	vec_free(&views);
+
+	size_t total = 0;
+	start = bench_now_ns();
+	struct csv_stream stream = csv_stream_create(',', count_field, &total);
+	for (int off = 0; off < csv.len - 1; off += 65536) {
+		int len = csv.len - 1 - off < 65536 ? csv.len - 1 - off : 65536;
+		csv_stream_feed(&stream, csv.buf + off, len);
+	}
+	csv_stream_finish(&stream);
+	bench_report("csv_stream 64KB chunks", n, bench_now_ns() - start, n);
+	printf("%zu bytes in fields\n", total);
+
+	str_free(&csv);
+	return 0;
+}
@@ -0,0 +1,209 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "scom/dict.h"
+#include "bench.h"
+
+/*
+ * Compare the DICT_LINEAR, DICT_SWISS and DICT_COMPACT layouts with string keys
+ * shaped like mangled C++ symbol names against the original scalar linear
+ * probing table. Also report the worst single dict_put latency with
+ * and without incremental rehash.
+ *
+ * Usage: ./a.out [n ...]. Default sizes are 10K, 1M and 10M keys.
+ */
+
+static char **make_keys(int n, uint64_t seed) {
+	char **keys = malloc(sizeof(char*) * n);
+	char buf[64];
+	for (int i = 0; i < n; ++i) {
+		snprintf(buf, sizeof(buf), "_ZN4scom6detail%dE%llx", i, (unsigned long long) (bench_rand(&seed) & 0xffff));
+		keys[i] = strdup(buf);
+	}
+	return keys;
+}
+
+/*
+ * Frozen copy of the table struct dict started from: linear probing without
+ * cached hashes or Robin Hood, at most 50% full. Kept as the baseline row.
+ * It uses the same hash_fn as the other rows so only the layout differs.
+ */
+struct base_dict {
+	struct dict_entry* entries;
+	int size;
+	int capacity;
+	hash_fn_t hash_fn;
+	eq_fn_t eq_fn;
+};
+
+static struct base_dict base_dict_create(hash_fn_t hash_fn, eq_fn_t eq_fn) {
+	struct base_dict dict;
+	dict.size = 0;
+	dict.capacity = 64;
+	dict.entries = (struct dict_entry*) calloc(dict.capacity, sizeof(struct dict_entry));
+	dict.hash_fn = hash_fn;
+	dict.eq_fn = eq_fn;
+	return dict;
+}
+
+static struct dict_entry* _base_dict_locate(struct base_dict* dict, void *key) {
+	int h = dict->hash_fn(key) % dict->capacity;
+	while (dict->entries[h].flags == ALLOCATED && !dict->eq_fn(key, dict->entries[h].key)) {
+		if (++h == dict->capacity) {
+			h = 0;
+		}
+	}
+	return &(dict->entries[h]);
+}
+
+static struct dict_entry* base_dict_find(struct base_dict* dict, void *key) {
+	struct dict_entry* entry = _base_dict_locate(dict, key);
+	return entry->flags == ALLOCATED ? entry : NULL;
+}
+
+static void base_dict_put(struct base_dict* dict, void *key, void *val) {
+	if ((dict->size << 1) >= dict->capacity) {
+		struct dict_entry* oldentries = dict->entries;
+		int oldcapacity = dict->capacity;
+		dict->capacity <<= 1;
+		dict->entries = (struct dict_entry*) calloc(dict->capacity, sizeof(struct dict_entry));
+		for (int i = 0; i < oldcapacity; ++i) {
+			if (oldentries[i].flags == ALLOCATED) {
+				*_base_dict_locate(dict, oldentries[i].key) = oldentries[i];
+			}
+		}
+		free(oldentries);
+	}
+	struct dict_entry* entry = _base_dict_locate(dict, key);
+	if (entry->flags == FREE) {
+		entry->flags = ALLOCATED;
+		++dict->size;
+	}
+	entry->key = key;
+	entry->val = val;
+}
+
+static void run_base(const char *name, char **keys, char **misses, int n) {
+	printf("%s\n", name);
+	struct base_dict dict = base_dict_create(str_hash_fn, str_eq_fn);
+	uint64_t start = bench_now_ns();
+	for (int i = 0; i < n; ++i) {
+		base_dict_put(&dict, keys[i], (void*) (intptr_t) i);
+	}
+	bench_report("insert", n, bench_now_ns() - start, n);
+
+	start = bench_now_ns();
+	intptr_t sum = 0;
+	for (int i = 0; i < n; ++i) {
+		sum += (intptr_t) base_dict_find(&dict, keys[i])->val;
+	}
+	bench_report("find hit", n, bench_now_ns() - start, n);
+
+	start = bench_now_ns();
+	int nmiss = 0;
+	for (int i = 0; i < n; ++i) {
+		nmiss += base_dict_find(&dict, misses[i]) == NULL;
+	}
+	bench_report("find miss", n, bench_now_ns() - start, n);
+	assert(nmiss == n);
+
+	start = bench_now_ns();
+	intptr_t iter_sum = 0;
+	for (int i = 0; i < dict.capacity; ++i) {
+		if (dict.entries[i].flags == ALLOCATED) {
+			iter_sum += (intptr_t) dict.entries[i].val;
+		}
+	}
+	bench_report("iterate", n, bench_now_ns() - start, n);
+	assert(iter_sum == sum);
+	assert(sum == (intptr_t) n * (n - 1) / 2);
+	free(dict.entries);
+}
+
+static void run(const char *name, struct dict (*create)(hash_fn_t, eq_fn_t, bool, bool), char **keys, char **misses, int n) {
+	printf("%s\n", name);
+	struct dict dict = create(str_hash_fn, str_eq_fn, 0, 0);
+	uint64_t start = bench_now_ns();
+	for (int i = 0; i < n; ++i) {
+		dict_put(&dict, keys[i], (void*) (intptr_t) i);
+	}
+	bench_report("insert", n, bench_now_ns() - start, n);
+
+	start = bench_now_ns();
+	intptr_t sum = 0;
+	for (int i = 0; i < n; ++i) {
+		sum += (intptr_t) dict_find(&dict, keys[i])->val;
+	}
+	bench_report("find hit", n, bench_now_ns() - start, n);
+
+	start = bench_now_ns();
+	int nmiss = 0;
+	for (int i = 0; i < n; ++i) {
+		nmiss += dict_find(&dict, misses[i]) == NULL;
+	}
+	bench_report("find miss", n, bench_now_ns() - start, n);
+	assert(nmiss == n);
+
+	start = bench_now_ns();
+	intptr_t iter_sum = 0;
+	DICT_FOREACH(&dict, entry) {
+		iter_sum += (intptr_t) entry->val;
+	}
+	bench_report("iterate", n, bench_now_ns() - start, n);
+	assert(iter_sum == sum);
+	assert(sum == (intptr_t) n * (n - 1) / 2);
+	dict_free(&dict);
+}
+
+static void run_put_latency(const char *name, bool incremental, char **keys, int n) {
+	struct dict dict = dict_create(str_hash_fn, str_eq_fn, 0, 0);
+	dict_set_incremental_rehash(&dict, incremental);
+	uint64_t worst = 0;
+	uint64_t total_start = bench_now_ns();
+	for (int i = 0; i < n; ++i) {
+		uint64_t start = bench_now_ns();
+		dict_put(&dict, keys[i], NULL);
+		uint64_t elapsed = bench_now_ns() - start;
+		if (elapsed > worst) {
+			worst = elapsed;
+		}
+	}
+	bench_report(name, n, bench_now_ns() - total_start, n);
+	printf("  %-28s worst put %.3f ms\n", "", worst / 1e6);
+	dict_free(&dict);
+}
+
+static void bench_size(int n) {
+	printf("== %d keys ==\n", n);
+	char **keys = make_keys(n, 0x1234);
+	char **misses = make_keys(n, 0x1234);
+	for (int i = 0; i < n; ++i) {
+		// same shape, different name
+		misses[i][1] = 'Y';
+	}
+	run_base("baseline linear", keys, misses, n);
+	run("DICT_LINEAR (Robin Hood)", dict_create, keys, misses, n);
+	run("DICT_SWISS", dict_create_swiss, keys, misses, n);
+	run("DICT_COMPACT", dict_create_compact, keys, misses, n);
+	printf("put latency\n");
+	run_put_latency("one-shot rehash", false, keys, n);
+	run_put_latency("incremental rehash", true, keys, n);
+	for (int i = 0; i < n; ++i) {
+		free(keys[i]);
+		free(misses[i]);
+	}
+	free(keys);
+	free(misses);
+}
+
+int main(int argc, char **argv) {
+	if (argc >= 2) {
+		for (int i = 1; i < argc; ++i) {
+			bench_size(atoi(argv[i]));
+		}
+	} else {
+		bench_size(10000);
+		bench_size(1000000);
+		bench_size(10000000);
+	}
+	return 0;
+}
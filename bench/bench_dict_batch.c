@@ -0,0 +1,67 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "scom/dict.h"
+#include "bench.h"
+
+/*
+ * dict_find_batch against a loop of dict_find with keys looked up in random
+ * order. The default size puts the entries array and the key strings well
+ * past the last level cache.
+ *
+ * Usage: ./a.out [n]. Default is 8M keys.
+ */
+
+#define NLOOKUP 4000000
+
+static void run(const char *name, struct dict (*create)(hash_fn_t, eq_fn_t, bool, bool), char **keys, int n, void **lookups) {
+	printf("%s\n", name);
+	struct dict dict = create(str_hash_fn, str_eq_fn, 0, 0);
+	for (int i = 0; i < n; ++i) {
+		dict_put(&dict, keys[i], (void*) (intptr_t) i);
+	}
+
+	uint64_t start = bench_now_ns();
+	intptr_t sum = 0;
+	for (int i = 0; i < NLOOKUP; ++i) {
+		struct dict_entry *entry = dict_find(&dict, lookups[i]);
+		sum += entry ? (intptr_t) entry->val : -1;
+	}
+	bench_report("dict_find loop", NLOOKUP, bench_now_ns() - start, NLOOKUP);
+
+	struct dict_entry **out = malloc(sizeof(struct dict_entry*) * NLOOKUP);
+	start = bench_now_ns();
+	dict_find_batch(&dict, lookups, NLOOKUP, out);
+	for (int i = 0; i < NLOOKUP; ++i) {
+		sum -= out[i] ? (intptr_t) out[i]->val : -1;
+	}
+	bench_report("dict_find_batch", NLOOKUP, bench_now_ns() - start, NLOOKUP);
+	assert(sum == 0);
+	free(out);
+	dict_free(&dict);
+}
+
+int main(int argc, char **argv) {
+	int n = argc >= 2 ? atoi(argv[1]) : 8000000;
+	char **keys = malloc(sizeof(char*) * n);
+	char buf[64];
+	uint64_t seed = 0x1234;
+	for (int i = 0; i < n; ++i) {
+		snprintf(buf, sizeof(buf), "_ZN4scom6detail%dE%llx", i, (unsigned long long) (bench_rand(&seed) & 0xffff));
+		keys[i] = strdup(buf);
+	}
+	// about 10% misses, like undefined symbols resolved against a library
+	void **lookups = malloc(sizeof(void*) * NLOOKUP);
+	for (int i = 0; i < NLOOKUP; ++i) {
+		lookups[i] = bench_rand(&seed) % 10 == 0 ? "_ZN4scom7missingEv" : keys[bench_rand(&seed) % n];
+	}
+	printf("%d keys, %d lookups\n", n, NLOOKUP);
+	run("DICT_LINEAR", dict_create, keys, n, lookups);
+	run("DICT_SWISS", dict_create_swiss, keys, n, lookups);
+	run("DICT_COMPACT", dict_create_compact, keys, n, lookups);
+	for (int i = 0; i < n; ++i) {
+		free(keys[i]);
+	}
+	free(keys);
+	free(lookups);
+	return 0;
+}
@@ -0,0 +1,94 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "scom/dict.h"
+#include "bench.h"
+
+/*
+ * Steady state insert/remove churn at a fixed table size. For each target
+ * load, fill the table and then repeatedly remove a random live key and insert
+ * a new one. Report throughput and the probe length (distance from the home
+ * slot) distribution of the DICT_LINEAR (Robin Hood) table afterwards.
+ *
+ * Usage: ./a.out [log2_capacity] [nop]
+ */
+
+static uint32_t int_hash_fn(void *key) {
+	uint32_t h = (uint32_t) (uintptr_t) key;
+	h ^= h >> 16;
+	h *= 0x85ebca6b;
+	h ^= h >> 13;
+	h *= 0xc2b2ae35;
+	h ^= h >> 16;
+	return h;
+}
+
+static bool int_eq_fn(void *lhs, void *rhs) {
+	return lhs == rhs;
+}
+
+static void report_probe_len(struct dict *dict) {
+	enum { NBUCKET = 7 };
+	const char *names[NBUCKET] = {"0", "1", "2", "3", "4-7", "8-15", "16+"};
+	int hist[NBUCKET] = {0};
+	int64_t total = 0;
+	int max = 0;
+	DICT_FOREACH(dict, entry) {
+		int dist = _dict_probe_dist(dict, entry - dict->entries);
+		int b = dist < 4 ? dist : dist < 8 ? 4 : dist < 16 ? 5 : 6;
+		++hist[b];
+		total += dist;
+		if (dist > max) {
+			max = dist;
+		}
+	}
+	printf("  probe len mean %.2f max %d:", (double) total / dict->size, max);
+	for (int i = 0; i < NBUCKET; ++i) {
+		printf(" [%s] %.1f%%", names[i], 100.0 * hist[i] / dict->size);
+	}
+	printf("\n");
+}
+
+static void run(int layout, int capacity, int load_pct, int nop) {
+	struct dict dict = layout == DICT_SWISS
+		? dict_create_swiss(int_hash_fn, int_eq_fn, 0, 0)
+		: dict_create(int_hash_fn, int_eq_fn, 0, 0);
+	// never grow past 'capacity' so the load stays at load_pct
+	dict.max_load_pct = 95;
+	int n = (int64_t) capacity * load_pct / 100;
+	uintptr_t *live = malloc(sizeof(uintptr_t) * n);
+	uintptr_t next_key = 1;
+	for (int i = 0; i < n; ++i) {
+		live[i] = next_key++;
+		dict_put(&dict, (void*) live[i], NULL);
+	}
+	assert(dict.capacity == capacity);
+
+	uint64_t rnd = 0x9e3779b97f4a7c15ull;
+	uint64_t start = bench_now_ns();
+	for (int i = 0; i < nop; ++i) {
+		int victim = bench_rand(&rnd) % n;
+		int removed = dict_remove(&dict, (void*) live[victim]);
+		assert(removed == 1);
+		live[victim] = next_key++;
+		dict_put(&dict, (void*) live[victim], NULL);
+	}
+	uint64_t elapsed = bench_now_ns() - start;
+	printf("%s load %d%%\n", layout == DICT_SWISS ? "DICT_SWISS" : "DICT_LINEAR", load_pct);
+	bench_report("remove+insert", n, elapsed, nop);
+	assert(dict.size == n);
+	if (layout == DICT_LINEAR) {
+		report_probe_len(&dict);
+	}
+	free(live);
+	dict_free(&dict);
+}
+
+int main(int argc, char **argv) {
+	int log2_capacity = argc >= 2 ? atoi(argv[1]) : 20;
+	int nop = argc >= 3 ? atoi(argv[2]) : 4000000;
+	for (int load_pct = 50; load_pct <= 90; load_pct += 10) {
+		run(DICT_LINEAR, 1 << log2_capacity, load_pct, nop);
+		run(DICT_SWISS, 1 << log2_capacity, load_pct, nop);
+	}
+	return 0;
+}
@@ -0,0 +1,102 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "scom/dict.h"
+#include "scom/dict_define.h"
+#include "bench.h"
+
+/*
+ * Lookup speed of DICT_DEFINE generated dicts against the generic struct dict
+ * for int->int and str->int maps.
+ *
+ * Usage: ./a.out [n]
+ */
+
+DICT_DEFINE(int_int_dict, int, int, dict_int_hash, dict_int_eq)
+DICT_DEFINE(str_int_dict, const char*, int, dict_cstr_hash, dict_cstr_eq)
+
+static uint32_t int_hash_fn(void *key) {
+	return dict_int_hash((int) (intptr_t) key);
+}
+
+static bool int_eq_fn(void *lhs, void *rhs) {
+	return lhs == rhs;
+}
+
+static void bench_int(int n, int *keys) {
+	printf("int -> int\n");
+	struct dict generic = dict_create(int_hash_fn, int_eq_fn, 0, 0);
+	struct int_int_dict typed = int_int_dict_create();
+	for (int i = 0; i < n; ++i) {
+		dict_put(&generic, (void*) (intptr_t) keys[i], (void*) (intptr_t) i);
+		int_int_dict_put(&typed, keys[i], i);
+	}
+
+	int64_t sum = 0;
+	uint64_t start = bench_now_ns();
+	for (int i = 0; i < n; ++i) {
+		sum += (intptr_t) dict_find(&generic, (void*) (intptr_t) keys[i])->val;
+	}
+	bench_report("struct dict find", n, bench_now_ns() - start, n);
+
+	start = bench_now_ns();
+	for (int i = 0; i < n; ++i) {
+		sum -= int_int_dict_find(&typed, keys[i])->val;
+	}
+	bench_report("DICT_DEFINE find", n, bench_now_ns() - start, n);
+	assert(sum == 0);
+	dict_free(&generic);
+	int_int_dict_free(&typed);
+}
+
+static void bench_str(int n, char **keys) {
+	printf("str -> int\n");
+	struct dict generic = dict_create(str_hash_fn, str_eq_fn, 0, 0);
+	struct str_int_dict typed = str_int_dict_create();
+	for (int i = 0; i < n; ++i) {
+		dict_put(&generic, keys[i], (void*) (intptr_t) i);
+		str_int_dict_put(&typed, keys[i], i);
+	}
+
+	int64_t sum = 0;
+	uint64_t start = bench_now_ns();
+	for (int i = 0; i < n; ++i) {
+		sum += (intptr_t) dict_find(&generic, keys[i])->val;
+	}
+	bench_report("struct dict find", n, bench_now_ns() - start, n);
+
+	start = bench_now_ns();
+	for (int i = 0; i < n; ++i) {
+		sum -= str_int_dict_find(&typed, keys[i])->val;
+	}
+	bench_report("DICT_DEFINE find", n, bench_now_ns() - start, n);
+	assert(sum == 0);
+	dict_free(&generic);
+	str_int_dict_free(&typed);
+}
+
+int main(int argc, char **argv) {
+	int n = argc >= 2 ? atoi(argv[1]) : 1000000;
+	uint64_t rnd = 7;
+	int *ikeys = malloc(sizeof(int) * n);
+	char **skeys = malloc(sizeof(char*) * n);
+	char buf[64];
+	for (int i = 0; i < n; ++i) {
+		// distinct keys in random order
+		ikeys[i] = i * 2654435761u;
+		snprintf(buf, sizeof(buf), "_ZN4scom6symbol%dEv", i);
+		skeys[i] = strdup(buf);
+	}
+	for (int i = n - 1; i > 0; --i) {
+		int j = bench_rand(&rnd) % (i + 1);
+		int t = ikeys[i]; ikeys[i] = ikeys[j]; ikeys[j] = t;
+		char *s = skeys[i]; skeys[i] = skeys[j]; skeys[j] = s;
+	}
+	bench_int(n, ikeys);
+	bench_str(n, skeys);
+	for (int i = 0; i < n; ++i) {
+		free(skeys[i]);
+	}
+	free(skeys);
+	free(ikeys);
+	return 0;
+}
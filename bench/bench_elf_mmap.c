@@ -0,0 +1,88 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+#include "scom/elf_writer.h"
+#include "scom/elf_reader.h"
+#include "bench.h"
+
+/*
+ * Open the same ELF file with an 'mb' MB .text 'n' times and keep all the
+ * readers alive, like a link holding all its inputs, with elfr_create (read
+ * into the heap) against elfr_create_mmap. Each variant runs in a child
+ * process so its peak RSS can be reported.
+ *
+ * Usage: ./a.out [n] [mb] [elf]. Given an existing 32-bit ELF file, e.g. an
+ * object with a large symtab, open that instead of generating one.
+ */
+
+static const char *PATH = "/tmp/bench_elf_mmap.elf";
+
+static void run(const char *name, int n, bool mapped) {
+	fflush(stdout);
+	pid_t pid = fork();
+	CHECK(pid >= 0, "fork fail");
+	if (pid > 0) {
+		int status;
+		waitpid(pid, &status, 0);
+		CHECK(WIFEXITED(status) && WEXITSTATUS(status) == 0, "%s failed", name);
+		return;
+	}
+
+	// elfr_create logs each file
+	FILE *out = fdopen(dup(STDOUT_FILENO), "w");
+	CHECK(freopen("/dev/null", "w", stdout), "fail to silence stdout");
+	struct elf_reader *readers = (struct elf_reader*) malloc(sizeof(struct elf_reader) * n);
+	uint64_t start = bench_now_ns();
+	for (int i = 0; i < n; ++i) {
+		readers[i] = mapped ? elfr_create_mmap(PATH, false) : elfr_create(PATH);
+	}
+	uint64_t open_ns = bench_now_ns() - start;
+	// the section headers and names are all a link looks at before it needs
+	// the content. The writer emits .text as a segment without a section.
+	int nfound = 0;
+	start = bench_now_ns();
+	for (int i = 0; i < n; ++i) {
+		nfound += elfr_get_shdr_by_name(&readers[i], ".shstrtab") != NULL;
+	}
+	uint64_t lookup_ns = bench_now_ns() - start;
+
+	struct rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+	fprintf(out, "%s\n", name);
+	stdout = out;
+	bench_report("open", n, open_ns, n);
+	bench_report("find .shstrtab", n, lookup_ns, n);
+	printf("  %-28s peak RSS %ld MB\n", "", usage.ru_maxrss / 1024);
+	CHECK(nfound == n, "missing .shstrtab");
+	for (int i = 0; i < n; ++i) {
+		elfr_free(&readers[i]);
+	}
+	free(readers);
+	exit(0);
+}
+
+int main(int argc, char **argv) {
+	int n = argc >= 2 ? atoi(argv[1]) : 64;
+	size_t mb = argc >= 3 ? atoi(argv[2]) : 8;
+	if (argc >= 4) {
+		PATH = argv[3];
+		run("elfr_create", n, false);
+		run("elfr_create_mmap", n, true);
+		return 0;
+	}
+
+	struct str text = str_create(0);
+	str_fill(&text, mb << 20, 0x90);
+	struct elf_writer writer = elfw_create();
+	// the writer owns text from here on
+	elfw_create_segment(&writer, ".text", &text, text.len);
+	elfw_write(&writer, PATH);
+	elfw_free(&writer);
+
+	run("elfr_create", n, false);
+	run("elfr_create_mmap", n, true);
+	unlink(PATH);
+	return 0;
+}
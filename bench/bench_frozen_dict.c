@@ -0,0 +1,75 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "scom/frozen_dict.h"
+#include "bench.h"
+
+/*
+ * Load and lookup cost of a frozen dict mapped from disk against rebuilding
+ * a struct dict from the same keys.
+ *
+ * Usage: ./a.out [n]
+ */
+
+static const char *path = "/tmp/bench_frozen_dict.fd";
+
+int main(int argc, char **argv) {
+	int n = argc > 1 ? atoi(argv[1]) : 1000000;
+	char **keys = (char**) malloc(sizeof(char*) * n);
+	char buf[32];
+	for (int i = 0; i < n; ++i) {
+		snprintf(buf, sizeof(buf), "_ZN4scom3sym%dEv", i);
+		keys[i] = strdup(buf);
+	}
+
+	uint64_t start = bench_now_ns();
+	struct dict src = dict_create(str_hash_fn, str_eq_fn, 0, 0);
+	for (int i = 0; i < n; ++i) {
+		dict_put(&src, keys[i], (void*) (uintptr_t) i);
+	}
+	bench_report("struct dict load (put n keys)", 1, bench_now_ns() - start, n);
+
+	start = bench_now_ns();
+	struct str image = frozen_dict_build(&src);
+	bench_report("frozen dict build", 1, bench_now_ns() - start, n);
+	printf("image size %d bytes, %.1f bytes/key\n", image.len, (double) image.len / n);
+	frozen_dict_write(&image, path);
+	str_free(&image);
+
+	start = bench_now_ns();
+	struct frozen_dict fd = frozen_dict_open(path);
+	bench_report("frozen dict load (open)", 1, bench_now_ns() - start, 1);
+
+	// random order so the big tables do not stay in cache
+	uint64_t state = 42;
+	int *order = (int*) malloc(sizeof(int) * n);
+	for (int i = 0; i < n; ++i) {
+		order[i] = bench_rand(&state) % n;
+	}
+
+	int64_t sum = 0;
+	start = bench_now_ns();
+	for (int i = 0; i < n; ++i) {
+		sum += (intptr_t) dict_find(&src, keys[order[i]])->val;
+	}
+	bench_report("struct dict find", n, bench_now_ns() - start, n);
+
+	start = bench_now_ns();
+	for (int i = 0; i < n; ++i) {
+		uint64_t val = 0;
+		// a miss leaves val at 0 and the sum check below catches it
+		frozen_dict_find(&fd, keys[order[i]], &val);
+		sum -= val;
+	}
+	bench_report("frozen dict find", n, bench_now_ns() - start, n);
+	assert(sum == 0);
+
+	frozen_dict_close(&fd);
+	unlink(path);
+	dict_free(&src);
+	for (int i = 0; i < n; ++i) {
+		free(keys[i]);
+	}
+	free(keys);
+	free(order);
+	return 0;
+}
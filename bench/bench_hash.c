@@ -0,0 +1,129 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "scom/dict.h"
+#include "scom/elf_reader.h"
+#include "bench.h"
+
+/*
+ * Compare the string hash functions on symbol names: speed in bytes per cycle,
+ * full 32 bit collisions, and the bucket spread / probe length they give a
+ * DICT_LINEAR table.
+ *
+ * Usage: ./a.out [elf_file ...]. Symbol and section names are extracted with
+ * elf_reader. Without files (or if they yield too few names) a synthetic corpus
+ * of mangled C++ names is used.
+ */
+
+struct corpus {
+	char **names;
+	int n;
+	int64_t nbytes;
+};
+
+static void corpus_add(struct corpus *c, struct dict *seen, const char *name) {
+	if (!*name || dict_find(seen, (void*) name)) {
+		return;
+	}
+	char *copy = strdup(name);
+	dict_put(seen, copy, NULL);
+	c->names = realloc(c->names, sizeof(char*) * (c->n + 1));
+	c->names[c->n++] = copy;
+	c->nbytes += strlen(copy);
+}
+
+static void corpus_add_elf(struct corpus *c, struct dict *seen, const char *path) {
+	struct elf_reader reader = elfr_create(path);
+	for (int i = 0; i < reader.symtab_size; ++i) {
+		corpus_add(c, seen, reader.symstr + reader.symtab[i].st_name);
+	}
+	for (int i = 0; i < reader.shtab_size; ++i) {
+		corpus_add(c, seen, reader.shstrtab + reader.shtab[i].sh_name);
+	}
+	elfr_free(&reader);
+}
+
+static void corpus_add_synthetic(struct corpus *c, struct dict *seen, int n) {
+	const char *ns[] = {"scom", "llvm", "std", "detail", "elf_reader", "vector", "basic_string"};
+	const char *fn[] = {"find", "insert", "size", "operator[]", "emplace_back", "resolve", "relocate"};
+	char buf[256];
+	uint64_t rnd = 42;
+	for (int i = 0; i < n; ++i) {
+		const char *a = ns[bench_rand(&rnd) % 7], *b = ns[bench_rand(&rnd) % 7];
+		const char *f = fn[bench_rand(&rnd) % 7];
+		snprintf(buf, sizeof(buf), "_ZN%zu%s%zu%sI%dE%zu%sEv", strlen(a), a, strlen(b), b, i, strlen(f), f);
+		corpus_add(c, seen, buf);
+	}
+}
+
+static int cmp_u32(const void *a, const void *b) {
+	uint32_t x = *(const uint32_t*) a, y = *(const uint32_t*) b;
+	return x < y ? -1 : x > y;
+}
+
+static void run(const char *name, hash_fn_t fn, struct corpus *c) {
+	uint32_t *hashes = malloc(sizeof(uint32_t) * c->n);
+
+	// speed
+	int nround = 1 + 20000000 / (c->nbytes + 1);
+	uint32_t sink = 0;
+	uint64_t start = bench_cycles();
+	for (int r = 0; r < nround; ++r) {
+		for (int i = 0; i < c->n; ++i) {
+			sink += fn(c->names[i]);
+		}
+	}
+	uint64_t cycles = bench_cycles() - start;
+
+	// full 32 bit collisions
+	for (int i = 0; i < c->n; ++i) {
+		hashes[i] = fn(c->names[i]);
+	}
+	qsort(hashes, c->n, sizeof(uint32_t), cmp_u32);
+	int ncollide = 0;
+	for (int i = 1; i < c->n; ++i) {
+		ncollide += hashes[i] == hashes[i - 1];
+	}
+
+	// spread over a DICT_LINEAR table
+	struct dict dict = dict_create(fn, str_eq_fn, 0, 0);
+	for (int i = 0; i < c->n; ++i) {
+		dict_put(&dict, c->names[i], NULL);
+	}
+	int64_t total_dist = 0;
+	int max_dist = 0, nhome = 0;
+	DICT_FOREACH(&dict, entry) {
+		int dist = _dict_probe_dist(&dict, entry - dict.entries);
+		total_dist += dist;
+		nhome += dist == 0;
+		max_dist = dist > max_dist ? dist : max_dist;
+	}
+	printf("  %-10s %6.2f bytes/cycle  %5d collisions  %5.1f%% at home  probe mean %.2f max %d  (%u)\n",
+		name, (double) c->nbytes * nround / cycles, ncollide,
+		100.0 * nhome / c->n, (double) total_dist / c->n, max_dist, sink & 1);
+	dict_free(&dict);
+	free(hashes);
+}
+
+int main(int argc, char **argv) {
+	struct corpus c = {0};
+	struct dict seen = dict_create(str_hash_fn, str_eq_fn, 0, 0);
+	for (int i = 1; i < argc; ++i) {
+		corpus_add_elf(&c, &seen, argv[i]);
+	}
+	if (c.n < 1000) {
+		printf("Use synthetic mangled names\n");
+		corpus_add_synthetic(&c, &seen, 200000);
+	}
+	printf("%d distinct names, %.1f bytes on average. crc32c uses %s\n",
+		c.n, (double) c.nbytes / c.n, hash_crc32c_is_hw() ? "SSE4.2" : "software");
+	run("mul23", str_hash_mul23_fn, &c);
+	run("wyhash", str_hash_fn, &c);
+	run("crc32c", str_crc32c_fn, &c);
+
+	dict_free(&seen);
+	for (int i = 0; i < c.n; ++i) {
+		free(c.names[i]);
+	}
+	free(c.names);
+	return 0;
+}
@@ -0,0 +1,104 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "scom/simd_str.h"
+#include "scom/str.h"
+#include "bench.h"
+
+/*
+ * Run the simd_str kernels at each level against the libc way of doing the
+ * same on a .strtab-like buffer of mangled names:
+ * - compare 4KB buffers (memcmp)
+ * - count the strings (strlen from string to string)
+ * - find any of 8 names (strstr per name)
+ *
+ * Usage: ./a.out [n]
+ */
+
+static const char *words[] = {"foo", "bar", "baz", "linker", "symbol", "reloc", "section", "reader", "writer", "dict"};
+#define NWORD (sizeof(words) / sizeof(*words))
+
+enum { NNEEDLE = 8 };
+
+int main(int argc, char **argv) {
+	int n = argc >= 2 ? atoi(argv[1]) : 200000;
+	uint64_t state = 88172645463325252ULL;
+	struct str strtab = str_create(0);
+	str_append(&strtab, '\0');
+	for (int i = 0; i < n; ++i) {
+		uint64_t r = bench_rand(&state);
+		const char *ns = words[r % NWORD], *cls = words[(r >> 8) % NWORD], *fn = words[(r >> 16) % NWORD];
+		str_appendf(&strtab, "_ZN5scom%zu%s%zu%s%zu%sEv_%d", strlen(ns), ns, strlen(cls), cls, strlen(fn), fn, i);
+		str_append(&strtab, '\0');
+	}
+	// names near the end, so the search goes through most of the table
+	char namebuf[NNEEDLE][64];
+	struct strview needles[NNEEDLE];
+	for (int j = 0; j < NNEEDLE; ++j) {
+		snprintf(namebuf[j], sizeof(namebuf[j]), "Ev_%d", n - 1 - j * 7);
+		needles[j] = strview_from_cstr(namebuf[j]);
+	}
+	enum { CMP_SIZE = 4096, NCMP = 20000 };
+	char *cmp_a = (char*) malloc(CMP_SIZE), *cmp_b = (char*) malloc(CMP_SIZE);
+	memset(cmp_a, 'x', CMP_SIZE);
+	memset(cmp_b, 'x', CMP_SIZE);
+	int nround = 20;
+	size_t sink = 0;
+
+	printf("strtab %d bytes, %d strings\n", strtab.len, n + 1);
+	printf("libc\n");
+	uint64_t start = bench_now_ns();
+	for (int i = 0; i < NCMP; ++i) {
+		cmp_b[CMP_SIZE - 1 - i % 16] = 'y';
+		sink += memcmp(cmp_a, cmp_b, CMP_SIZE) != 0;
+		cmp_b[CMP_SIZE - 1 - i % 16] = 'x';
+	}
+	bench_report("memcmp 4KB", NCMP, bench_now_ns() - start, NCMP);
+	start = bench_now_ns();
+	for (int round = 0; round < nround; ++round) {
+		for (const char *s = strtab.buf; s < strtab.buf + strtab.len; s += strlen(s) + 1) {
+			++sink;
+		}
+	}
+	bench_report("count strings (strlen)", nround, bench_now_ns() - start, nround);
+	start = bench_now_ns();
+	for (int round = 0; round < nround; ++round) {
+		// strstr stops at the first '\0', so go string by string
+		for (const char *s = strtab.buf; s < strtab.buf + strtab.len; s += strlen(s) + 1) {
+			for (int j = 0; j < NNEEDLE; ++j) {
+				sink += strstr(s, namebuf[j]) != NULL;
+			}
+		}
+	}
+	bench_report("find any of 8 (strstr)", nround, bench_now_ns() - start, nround);
+
+	for (int level = SIMD_SCALAR; level <= SIMD_AVX2; ++level) {
+		if (simd_str_set_level((enum simd_level) level) != level) {
+			break;
+		}
+		printf("%s\n", simd_level_name((enum simd_level) level));
+		start = bench_now_ns();
+		for (int i = 0; i < NCMP; ++i) {
+			cmp_b[CMP_SIZE - 1 - i % 16] = 'y';
+			sink += simd_memeq(cmp_a, cmp_b, CMP_SIZE);
+			cmp_b[CMP_SIZE - 1 - i % 16] = 'x';
+		}
+		bench_report("simd_memeq 4KB", NCMP, bench_now_ns() - start, NCMP);
+		start = bench_now_ns();
+		for (int round = 0; round < nround; ++round) {
+			sink += simd_count_strings(strtab.buf, strtab.len);
+		}
+		bench_report("simd_count_strings", nround, bench_now_ns() - start, nround);
+		start = bench_now_ns();
+		for (int round = 0; round < nround; ++round) {
+			int which;
+			sink += simd_find_any(strtab.buf, strtab.len, needles, NNEEDLE, &which) != NULL;
+		}
+		bench_report("simd_find_any of 8", nround, bench_now_ns() - start, nround);
+	}
+	printf("(%zu)\n", sink);
+
+	free(cmp_a);
+	free(cmp_b);
+	str_free(&strtab);
+	return 0;
+}
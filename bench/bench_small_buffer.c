@@ -0,0 +1,109 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "scom/elf_reader.h"
+#include "scom/str.h"
+#include "bench.h"
+
+/*
+ * Count heap allocations of a per-object-file ELF reading workload with heap
+ * backed vec/str against inline storage (vec_create_inline/str_create_inline).
+ * For each file:
+ * - collect the global defined symbols and their weak flags, plus the
+ *   undefined symbols, into per-file vecs.
+ * - build the name of an output section for each input section in a str.
+ *
+ * malloc, calloc and realloc are wrapped with -Wl,--wrap to count calls.
+ *
+ * Usage: ./a.out [elf32_file ...] (default /tmp/sum.o)
+ */
+
+static int64_t nalloc;
+static int counting;
+
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t n, size_t size);
+void *__real_realloc(void *ptr, size_t size);
+
+void *__wrap_malloc(size_t size) {
+	nalloc += counting;
+	return __real_malloc(size);
+}
+
+void *__wrap_calloc(size_t n, size_t size) {
+	nalloc += counting;
+	return __real_calloc(n, size);
+}
+
+void *__wrap_realloc(void *ptr, size_t size) {
+	nalloc += counting;
+	return __real_realloc(ptr, size);
+}
+
+#define ROUNDS 10000
+
+static uint64_t workload(struct elf_reader *reader, bool use_inline) {
+	char *name_storage[16], *undef_storage[16];
+	bool weak_storage[16];
+	char secname_storage[32];
+	uint64_t checksum = 0;
+
+	struct vec names = use_inline ? VEC_CREATE_INLINE(sizeof(char*), name_storage) : vec_create(sizeof(char*));
+	struct vec weaks = use_inline ? VEC_CREATE_INLINE(sizeof(bool), weak_storage) : vec_create(sizeof(bool));
+	struct vec undefs = use_inline ? VEC_CREATE_INLINE(sizeof(char*), undef_storage) : vec_create(sizeof(char*));
+	elfr_get_global_defined_syms2(reader, &names, &weaks);
+	for (int i = 0; i < reader->symtab_size; ++i) {
+		Elf32_Sym* sym = reader->symtab + i;
+		if (ELF32_ST_BIND(sym->st_info) == STB_GLOBAL && sym->st_shndx == 0) {
+			char *name = reader->symstr + sym->st_name;
+			vec_append(&undefs, &name);
+		}
+	}
+	checksum += names.len + weaks.len + undefs.len;
+	vec_free(&names);
+	vec_free(&weaks);
+	vec_free(&undefs);
+
+	for (int i = 0; i < reader->shtab_size; ++i) {
+		struct str secname = use_inline ? STR_CREATE_INLINE(secname_storage) : str_create(0);
+		str_lenconcat(&secname, ".out", 4);
+		str_concat(&secname, reader->shstrtab + reader->shtab[i].sh_name);
+		checksum += secname.len;
+		str_free(&secname);
+	}
+	return checksum;
+}
+
+int main(int argc, char **argv) {
+	const char *default_files[] = {"/tmp/sum.o"};
+	const char **files = argc >= 2 ? (const char**) argv + 1 : default_files;
+	int nfile = argc >= 2 ? argc - 1 : 1;
+
+	struct elf_reader *readers = malloc(sizeof(struct elf_reader) * nfile);
+	for (int i = 0; i < nfile; ++i) {
+		readers[i] = elfr_create(files[i]);
+	}
+
+	for (int use_inline = 0; use_inline <= 1; ++use_inline) {
+		uint64_t checksum = 0;
+		nalloc = 0;
+		counting = 1;
+		uint64_t start = bench_now_ns();
+		for (int r = 0; r < ROUNDS; ++r) {
+			for (int i = 0; i < nfile; ++i) {
+				checksum += workload(&readers[i], use_inline);
+			}
+		}
+		uint64_t ns = bench_now_ns() - start;
+		counting = 0;
+		printf("%s\n", use_inline ? "inline storage" : "heap");
+		bench_report("per file", ROUNDS * nfile, ns, ROUNDS * nfile);
+		printf("  %-28s %.2f allocations per file (checksum %llu)\n", "",
+			(double) nalloc / (ROUNDS * nfile), (unsigned long long) checksum);
+	}
+
+	for (int i = 0; i < nfile; ++i) {
+		elfr_free(&readers[i]);
+	}
+	free(readers);
+	return 0;
+}
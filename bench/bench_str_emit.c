@@ -0,0 +1,59 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "scom/str.h"
+#include "bench.h"
+
+/*
+ * Emit n 12-byte instructions (mov $imm, %eax; mov $imm, %ebx; int $0x80)
+ * into a str one byte at a time with str_append against the fixed width
+ * emitters, and copy them with str_write_bytes. The strs are reserved and
+ * touched up front so only the emission is timed.
+ *
+ * Usage: ./a.out [n]
+ */
+
+int main(int argc, char **argv) {
+	int n = argc >= 2 ? atoi(argv[1]) : 1000000;
+
+	struct str bytewise = str_create(0);
+	str_reserve(&bytewise, n * 12);
+	str_fill(&bytewise, n * 12, 0);
+	bytewise.len = 0;
+	uint64_t start = bench_now_ns();
+	for (int i = 0; i < n; ++i) {
+		str_append(&bytewise, 0xb8);
+		str_append(&bytewise, i); str_append(&bytewise, i >> 8); str_append(&bytewise, i >> 16); str_append(&bytewise, i >> 24);
+		str_append(&bytewise, 0xbb);
+		str_append(&bytewise, i); str_append(&bytewise, i >> 8); str_append(&bytewise, i >> 16); str_append(&bytewise, i >> 24);
+		str_append(&bytewise, 0xcd); str_append(&bytewise, 0x80);
+	}
+	bench_report("str_append x12", n, bench_now_ns() - start, n);
+
+	struct str put = str_create(0);
+	str_reserve(&put, n * 12);
+	str_fill(&put, n * 12, 0);
+	put.len = 0;
+	start = bench_now_ns();
+	for (int i = 0; i < n; ++i) {
+		str_put_u8(&put, 0xb8); str_put_u32(&put, i);
+		str_put_u8(&put, 0xbb); str_put_u32(&put, i);
+		str_put_u16(&put, 0x80cd);
+	}
+	bench_report("str_put_u8/u16/u32", n, bench_now_ns() - start, n);
+	assert(put.len == bytewise.len && memcmp(put.buf, bytewise.buf, put.len) == 0);
+
+	struct str copy = str_create(0);
+	str_reserve(&copy, n * 12);
+	str_fill(&copy, n * 12, 0);
+	copy.len = 0;
+	start = bench_now_ns();
+	for (int i = 0; i < n; ++i) {
+		str_write_bytes(&copy, put.buf + i * 12, 12);
+	}
+	bench_report("str_write_bytes 12", n, bench_now_ns() - start, n);
+
+	str_free(&copy);
+	str_free(&put);
+	str_free(&bytewise);
+	return 0;
+}
@@ -0,0 +1,74 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "scom/strtab.h"
+#include "bench.h"
+
+/*
+ * Build a string table for n functions compiled with -ffunction-sections:
+ * for each function its mangled name plus ".text.<name>" and
+ * ".rel.text.<name>", with names drawn so a fraction repeat. Compare the
+ * section size of plain str_concat, of deduplication only and of the
+ * tail-merged strtab, and time strtab_finalize.
+ *
+ * Usage: ./a.out [n]
+ */
+
+static const char *words[] = {"foo", "bar", "baz", "linker", "symbol", "reloc", "section", "reader", "writer", "dict"};
+#define NWORD (sizeof(words) / sizeof(*words))
+
+int main(int argc, char **argv) {
+	int n = argc >= 2 ? atoi(argv[1]) : 200000;
+	uint64_t state = 88172645463325252ULL;
+	// the names, '\0' separated
+	struct str names = str_create(0);
+	char name[96];
+	for (int i = 0; i < n; ++i) {
+		uint64_t r = bench_rand(&state);
+		const char *ns = words[r % NWORD], *cls = words[(r >> 8) % NWORD], *fn = words[(r >> 16) % NWORD];
+		int id = (r >> 32) % (n / 1000 + 1);
+		snprintf(name, sizeof(name), "_ZN%zu%s%zu%s%zu%sEv_%d", strlen(ns), ns, strlen(cls), cls, strlen(fn), fn, id);
+		str_concat(&names, name);
+		str_appendf(&names, ".text.%s", name);
+		str_append(&names, '\0');
+		str_appendf(&names, ".rel.text.%s", name);
+		str_append(&names, '\0');
+	}
+	int nstr = 3 * n;
+
+	struct str naive = str_create(0);
+	str_append(&naive, '\0');
+	uint64_t start = bench_now_ns();
+	for (const char *s = names.buf; s < names.buf + names.len; s += strlen(s) + 1) {
+		str_concat(&naive, s);
+	}
+	uint64_t concat_ns = bench_now_ns() - start;
+
+	struct strtab st = strtab_create();
+	start = bench_now_ns();
+	for (const char *s = names.buf; s < names.buf + names.len; s += strlen(s) + 1) {
+		strtab_add(&st, s);
+	}
+	uint64_t add_ns = bench_now_ns() - start;
+
+	int dedup_size = 1;
+	for (int i = 0; i < intern_size(&st.names); ++i) {
+		dedup_size += strlen(intern_get(&st.names, i)) + 1;
+	}
+
+	start = bench_now_ns();
+	strtab_finalize(&st);
+	uint64_t finalize_ns = bench_now_ns() - start;
+
+	printf("%d strings, %d distinct\n", nstr, intern_size(&st.names));
+	bench_report("str_concat", nstr, concat_ns, nstr);
+	bench_report("strtab_add", nstr, add_ns, nstr);
+	bench_report("strtab_finalize", intern_size(&st.names), finalize_ns, intern_size(&st.names));
+	printf("  %-28s %d bytes\n", "str_concat", naive.len);
+	printf("  %-28s %d bytes\n", "dedup only", dedup_size);
+	printf("  %-28s %d bytes\n", "dedup + tail merge", strtab_size(&st));
+
+	str_free(&names);
+	str_free(&naive);
+	strtab_free(&st);
+	return 0;
+}
@@ -0,0 +1,87 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "scom/dict.h"
+#include "scom/str.h"
+#include "bench.h"
+
+/*
+ * Symbol names as they sit in a .strtab: long mangled names sharing a
+ * prefix. Compare looking them up in a str_hash_fn dict and testing a prefix
+ * and suffix with the C string functions (strlen on every call) against the
+ * strview ones with the lengths computed once.
+ *
+ * Usage: ./a.out [n]
+ */
+
+static const char *words[] = {"foo", "bar", "baz", "linker", "symbol", "reloc", "section", "reader", "writer", "dict"};
+#define NWORD (sizeof(words) / sizeof(*words))
+
+int main(int argc, char **argv) {
+	int n = argc >= 2 ? atoi(argv[1]) : 200000;
+	int nround = 5;
+	uint64_t state = 88172645463325252ULL;
+	struct str strtab = str_create(0);
+	int *offs = (int*) malloc(sizeof(int) * n);
+	for (int i = 0; i < n; ++i) {
+		uint64_t r = bench_rand(&state);
+		const char *ns = words[r % NWORD], *cls = words[(r >> 8) % NWORD], *fn = words[(r >> 16) % NWORD];
+		offs[i] = str_appendf(&strtab, "_ZN5scom%zu%s%zu%s%zu%sEv_%d", strlen(ns), ns, strlen(cls), cls, strlen(fn), fn, i);
+		str_append(&strtab, '\0');
+	}
+	const char **names = (const char**) malloc(sizeof(char*) * n);
+	struct strview *views = (struct strview*) malloc(sizeof(struct strview) * n);
+	for (int i = 0; i < n; ++i) {
+		names[i] = strtab.buf + offs[i];
+		views[i] = strview_from_cstr(names[i]);
+	}
+
+	struct dict dict = dict_create_with_capacity(str_hash_fn, str_eq_fn, 0, 0, n);
+	for (int i = 0; i < n; i += 2) {
+		dict_put(&dict, (void*) names[i], (void*) (intptr_t) i);
+	}
+
+	int hit = 0;
+	uint64_t start = bench_now_ns();
+	for (int round = 0; round < nround; ++round) {
+		for (int i = 0; i < n; ++i) {
+			hit += dict_find(&dict, (void*) names[i]) != NULL;
+		}
+	}
+	uint64_t find_ns = bench_now_ns() - start;
+	start = bench_now_ns();
+	for (int round = 0; round < nround; ++round) {
+		for (int i = 0; i < n; ++i) {
+			hit += dict_find_view(&dict, views[i]) != NULL;
+		}
+	}
+	uint64_t find_view_ns = bench_now_ns() - start;
+
+	struct strview prefix = strview_from_cstr("_ZN5scom6linker"), suffix = strview_from_cstr("Ev_7");
+	start = bench_now_ns();
+	for (int round = 0; round < nround; ++round) {
+		for (int i = 0; i < n; ++i) {
+			hit += startswith(names[i], prefix.ptr) + endswith(names[i], suffix.ptr);
+		}
+	}
+	uint64_t affix_ns = bench_now_ns() - start;
+	start = bench_now_ns();
+	for (int round = 0; round < nround; ++round) {
+		for (int i = 0; i < n; ++i) {
+			hit += strview_startswith(views[i], prefix) + strview_endswith(views[i], suffix);
+		}
+	}
+	uint64_t affix_view_ns = bench_now_ns() - start;
+
+	printf("%d names, %d hits\n", n, hit);
+	bench_report("dict_find", nround * n, find_ns, nround * n);
+	bench_report("dict_find_view", nround * n, find_view_ns, nround * n);
+	bench_report("startswith+endswith", nround * n, affix_ns, nround * n);
+	bench_report("strview_startswith+endswith", nround * n, affix_view_ns, nround * n);
+
+	dict_free(&dict);
+	free(names);
+	free(views);
+	free(offs);
+	str_free(&strtab);
+	return 0;
+}
@@ -0,0 +1,100 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "scom/threadpool.h"
+#include "scom/elf_reader.h"
+#include "bench.h"
+
+/*
+ * Scaling of parallel_map over a many-file ELF workload. 'nfile' in-memory
+ * copies of the object files stand in for the inputs of a link. For each
+ * file: parse it, collect its global defined and undefined symbols, hash the
+ * names and checksum the whole file (like applying relocations would touch
+ * it). The per-file results are mapped into a vec.
+ *
+ * Run with 1, 2, 4, ... threads up to twice the number of cores.
+ *
+ * Usage: ./a.out [nfile] [elf32_file ...] (default /tmp/sum.o)
+ */
+
+struct input {
+	char *buf;
+	int size;
+};
+
+static void process_file(void *ctx, const void *in, void *out, size_t idx) {
+	const struct input *input = (const struct input*) in;
+	struct elf_reader reader = elfr_create_from_buffer(input->buf, input->size, false);
+	uint64_t sum = 0;
+
+	struct vec names = elfr_get_global_defined_syms(&reader);
+	VEC_FOREACH(&names, char*, name) {
+		sum += str_hash_fn(*name);
+	}
+	vec_free(&names);
+	struct vec undefs = elfr_get_undefined_syms(&reader);
+	VEC_FOREACH(&undefs, char*, undef) {
+		sum += str_hash_fn(*undef) * 3;
+	}
+	vec_free(&undefs);
+
+	uint64_t h = 14695981039346656037ULL;
+	for (int i = 0; i < input->size; ++i) {
+		h = (h ^ (uint8_t) input->buf[i]) * 1099511628211ULL;
+	}
+	elfr_free(&reader);
+	*(uint64_t*) out = sum ^ h;
+}
+
+int main(int argc, char **argv) {
+	int nfile = argc >= 2 ? atoi(argv[1]) : 20000;
+	const char *default_files[] = {"/tmp/sum.o"};
+	const char **files = argc >= 3 ? (const char**) argv + 2 : default_files;
+	int nsrc = argc >= 3 ? argc - 2 : 1;
+
+	struct vec inputs = vec_create(sizeof(struct input));
+	for (int i = 0; i < nfile; ++i) {
+		struct input input;
+		if (i < nsrc) {
+			input.buf = _elfr_read_file(files[i], &input.size);
+		} else {
+			struct input *src = (struct input*) vec_get_item(&inputs, i % nsrc);
+			input.size = src->size;
+			input.buf = malloc(input.size);
+			memcpy(input.buf, src->buf, input.size);
+		}
+		vec_append(&inputs, &input);
+	}
+	int ncore = (int) sysconf(_SC_NPROCESSORS_ONLN);
+	printf("%d files, %d cores\n", nfile, ncore);
+
+	uint64_t base_ns = 0, expected = 0;
+	for (int nthread = 1; nthread <= 2 * ncore || nthread == 1; nthread *= 2) {
+		struct threadpool *pool = threadpool_create(nthread);
+		struct vec results = vec_create(sizeof(uint64_t));
+		uint64_t start = bench_now_ns();
+		parallel_map(pool, &inputs, &results, process_file, NULL, 0);
+		uint64_t ns = bench_now_ns() - start;
+		threadpool_free(pool);
+
+		uint64_t checksum = 0;
+		VEC_FOREACH(&results, uint64_t, r) {
+			checksum += *r;
+		}
+		vec_free(&results);
+		if (nthread == 1) {
+			base_ns = ns;
+			expected = checksum;
+		}
+		assert(checksum == expected);
+		char name[32];
+		snprintf(name, sizeof(name), "%d threads", nthread);
+		bench_report(name, nfile, ns, nfile);
+		printf("  %-28s speedup %.2fx\n", "", (double) base_ns / ns);
+	}
+
+	VEC_FOREACH(&inputs, struct input, input) {
+		free(input->buf);
+	}
+	vec_free(&inputs);
+	return 0;
+}
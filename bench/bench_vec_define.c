@@ -0,0 +1,99 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "scom/vec_define.h"
+#include "bench.h"
+
+/*
+ * Push and sum n items with the generic vec functions against the
+ * VEC_DEFINE generated ones. The vecs are refilled 'rounds' times after
+ * the first growth so the numbers are not dominated by realloc and page
+ * faults.
+ *
+ * Usage: ./a.out [n] [rounds]
+ */
+
+struct sym {
+	uint32_t name;
+	uint32_t value;
+	uint32_t size;
+	uint32_t info;
+};
+
+VEC_DEFINE(sym_vec, struct sym)
+
+// not inlined so the item size of the vec is not known at compile time, like
+// a loop in a function that gets the vec passed in
+static __attribute__((noipa)) uint64_t sum_generic(struct vec *vec) {
+	uint64_t sum = 0;
+	VEC_FOREACH(vec, struct sym, sym) {
+		sum += sym->value;
+	}
+	return sum;
+}
+
+static __attribute__((noipa)) uint64_t sum_typed(struct vec *vec) {
+	uint64_t sum = 0;
+	VEC_DEFINE_FOREACH(sym_vec, vec, sym) {
+		sum += sym->value;
+	}
+	return sum;
+}
+
+int main(int argc, char **argv) {
+	int n = argc >= 2 ? atoi(argv[1]) : 100000;
+	int rounds = argc >= 3 ? atoi(argv[2]) : 100;
+	int64_t nop = (int64_t) n * rounds;
+	struct vec generic = vec_create(sizeof(struct sym));
+	struct vec typed = sym_vec_create();
+	for (int i = 0; i < n; ++i) {
+		struct sym sym = {i, i, 1, 0};
+		vec_append(&generic, &sym);
+		sym_vec_push(&typed, sym);
+	}
+
+	uint64_t start = bench_now_ns();
+	for (int r = 0; r < rounds; ++r) {
+		generic.len = 0;
+		for (int i = 0; i < n; ++i) {
+			struct sym sym = {i, i + r, 1, 0};
+			vec_append(&generic, &sym);
+		}
+	}
+	bench_report("vec_append", nop, bench_now_ns() - start, nop);
+
+	start = bench_now_ns();
+	for (int r = 0; r < rounds; ++r) {
+		typed.len = 0;
+		for (int i = 0; i < n; ++i) {
+			struct sym sym = {i, i + r, 1, 0};
+			sym_vec_push(&typed, sym);
+		}
+	}
+	bench_report("sym_vec_push", nop, bench_now_ns() - start, nop);
+
+	uint64_t sum = 0;
+	start = bench_now_ns();
+	for (int r = 0; r < rounds; ++r) {
+		sum += sum_generic(&generic);
+	}
+	bench_report("VEC_FOREACH", nop, bench_now_ns() - start, nop);
+
+	start = bench_now_ns();
+	for (int r = 0; r < rounds; ++r) {
+		for (int i = 0; i < typed.len; ++i) {
+			sum -= sym_vec_at_unchecked(&typed, i)->value;
+		}
+	}
+	bench_report("sym_vec_at_unchecked", nop, bench_now_ns() - start, nop);
+
+	start = bench_now_ns();
+	for (int r = 0; r < rounds; ++r) {
+		sum += sum_typed(&typed);
+	}
+	bench_report("VEC_DEFINE_FOREACH", nop, bench_now_ns() - start, nop);
+	printf("checksum %llu\n", (unsigned long long) sum);
+
+	vec_free(&generic);
+	vec_free(&typed);
+	return 0;
+}
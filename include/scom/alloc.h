@@ -0,0 +1,118 @@
+#pragma once
+
+/*
+ * A minimal allocator interface so containers can take their memory from
+ * something other than libc, e.g. an arena freed in one go at the end of a
+ * link phase, or a wrapper that accounts the memory of a phase.
+ *
+ * Containers keep a 'struct allocator*'. NULL means libc
+ * malloc/realloc/free, so code that never sets an allocator behaves exactly as
+ * before and pays only a NULL check.
+ *
+ * The allocator must outlive every container using it.
+ */
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include "scom/check.h"
+
+struct allocator {
+	// return NULL on failure
+	void *(*alloc)(void *ctx, size_t size);
+	// ptr may be NULL, in which case it behaves like alloc
+	void *(*realloc)(void *ctx, void *ptr, size_t size);
+	// ptr may be NULL
+	void (*free)(void *ctx, void *ptr);
+	void *ctx;
+};
+
+static inline void *alloc_malloc(struct allocator *a, size_t size) {
+	void *ptr = a ? a->alloc(a->ctx, size) : malloc(size);
+	CHECK(ptr || size == 0, "fail to allocate %zu bytes", size);
+	return ptr;
+}
+
+static inline void *alloc_calloc(struct allocator *a, size_t n, size_t size) {
+	if (!a) {
+		void *ptr = calloc(n, size);
+		CHECK(ptr || n == 0 || size == 0, "fail to allocate %zu x %zu bytes", n, size);
+		return ptr;
+	}
+	CHECK(size == 0 || n <= SIZE_MAX / size, "allocation size overflow: %zu x %zu bytes", n, size);
+	void *ptr = alloc_malloc(a, n * size);
+	memset(ptr, 0, n * size);
+	return ptr;
+}
+
+static inline void *alloc_realloc(struct allocator *a, void *ptr, size_t size) {
+	void *newptr = a ? a->realloc(a->ctx, ptr, size) : realloc(ptr, size);
+	CHECK(newptr || size == 0, "fail to reallocate %zu bytes", size);
+	return newptr;
+}
+
+static inline void alloc_free(struct allocator *a, void *ptr) {
+	if (a) {
+		a->free(a->ctx, ptr);
+	} else {
+		free(ptr);
+	}
+}
+
+/*
+ * lenstrdup with memory from 'a'.
+ */
+static inline char *alloc_lenstrdup(struct allocator *a, const char *src, size_t len) {
+	char *dst = (char*) alloc_malloc(a, len + 1);
+	memcpy(dst, src, len);
+	dst[len] = '\0';
+	return dst;
+}
+
+/*
+ * An allocator forwarding to 'parent' (NULL for libc) that counts the calls
+ * and the bytes requested, e.g. to account the memory of one link phase.
+ * Set up with counting_allocator_init and pass &ca->base to containers.
+ */
+struct counting_allocator {
+	struct allocator base; // ctx points back to this struct
+	struct allocator *parent;
+	uint64_t nalloc; // alloc and realloc calls
+	uint64_t nfree;
+	uint64_t nbytes; // bytes requested by alloc and realloc
+};
+
+static void *_counting_alloc(void *ctx, size_t size) {
+	struct counting_allocator *ca = (struct counting_allocator*) ctx;
+	++ca->nalloc;
+	ca->nbytes += size;
+	return alloc_malloc(ca->parent, size);
+}
+
+static void *_counting_realloc(void *ctx, void *ptr, size_t size) {
+	struct counting_allocator *ca = (struct counting_allocator*) ctx;
+	++ca->nalloc;
+	ca->nbytes += size;
+	return alloc_realloc(ca->parent, ptr, size);
+}
+
+static void _counting_free(void *ctx, void *ptr) {
+	struct counting_allocator *ca = (struct counting_allocator*) ctx;
+	if (ptr) {
+		++ca->nfree;
+	}
+	alloc_free(ca->parent, ptr);
+}
+
+/*
+ * ca->base.ctx points back to ca, so don't copy the struct after passing
+ * &ca->base to a container.
+ */
+static inline void counting_allocator_init(struct counting_allocator *ca, struct allocator *parent) {
+	memset(ca, 0, sizeof(*ca));
+	ca->base.alloc = _counting_alloc;
+	ca->base.realloc = _counting_realloc;
+	ca->base.free = _counting_free;
+	ca->base.ctx = ca;
+	ca->parent = parent;
+}
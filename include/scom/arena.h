@@ -0,0 +1,210 @@
+#pragma once
+
+/*
+ * A bump allocator for objects that die together, e.g. the names, symbol
+ * vectors and dict keys of one link.
+ *
+ * Memory is carved from a list of chunks. Allocation bumps a pointer, there is
+ * no per-object free, and arena_release drops all chunks in one go. So the
+ * teardown costs O(chunks) instead of O(objects).
+ *
+ *   struct arena arena;
+ *   arena_init(&arena, 0);
+ *   char *name = arena_lenstrdup(&arena, sym, len);
+ *   struct vec syms = vec_create_with_alloc(sizeof(char*), &arena.base);
+ *   ...
+ *   arena_release(&arena); // no vec_free/dict_free needed
+ *
+ * arena_mark/arena_rewind give checkpoints: everything allocated after a mark
+ * is dropped by rewinding to it, e.g. the scratch memory of one input file.
+ *
+ * &arena->base is a struct allocator (alloc.h), so vec, str and dict can take
+ * their memory from the arena. Its free is a no-op and realloc grows the last
+ * allocation in place when it can. Containers on an arena don't need to be
+ * freed; freeing them is harmless but still walks owned items.
+ */
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include "scom/check.h"
+#include "scom/alloc.h"
+
+// alignment of arena_alloc and of memory handed out through &arena->base.
+#define ARENA_DEFAULT_ALIGN 16
+#define ARENA_DEFAULT_CHUNK_SIZE 4096
+// chunks double in size up to this. Larger requests get a chunk of their own.
+#define ARENA_MAX_CHUNK_SIZE (1 << 20)
+
+struct arena_chunk {
+	struct arena_chunk *prev;
+	size_t size; // bytes in data
+	char data[];
+};
+
+struct arena {
+	struct allocator base; // ctx points back to this struct
+	struct arena_chunk *head; // the chunk being bumped; NULL if there is none
+	char *ptr; // next free byte in head
+	char *end; // end of head
+	size_t chunk_size; // size of the next chunk
+	int nchunk;
+};
+
+struct arena_mark {
+	struct arena_chunk *chunk;
+	char *ptr;
+};
+
+static void *_arena_alloc_fn(void *ctx, size_t size);
+static void *_arena_realloc_fn(void *ctx, void *ptr, size_t size);
+static void _arena_free_fn(void *ctx, void *ptr);
+
+/*
+ * chunk_size is the size of the first chunk, 0 for ARENA_DEFAULT_CHUNK_SIZE.
+ * No memory is allocated until the first allocation.
+ *
+ * arena->base.ctx points back to arena, so don't copy the struct after
+ * passing &arena->base to a container.
+ */
+static inline void arena_init(struct arena *arena, size_t chunk_size) {
+	memset(arena, 0, sizeof(*arena));
+	arena->base.alloc = _arena_alloc_fn;
+	arena->base.realloc = _arena_realloc_fn;
+	arena->base.free = _arena_free_fn;
+	arena->base.ctx = arena;
+	arena->chunk_size = chunk_size ? chunk_size : ARENA_DEFAULT_CHUNK_SIZE;
+}
+
+/*
+ * Start a new chunk with room for 'size' bytes aligned to 'align'.
+ */
+static void _arena_new_chunk(struct arena *arena, size_t size, size_t align) {
+	CHECK(size <= SIZE_MAX - align - sizeof(struct arena_chunk), "arena allocation too large: %zu bytes", size);
+	size_t need = size + align - 1;
+	size_t chunk_size = arena->chunk_size;
+	if (need > chunk_size) {
+		chunk_size = need;
+	} else if (arena->chunk_size < ARENA_MAX_CHUNK_SIZE) {
+		arena->chunk_size <<= 1;
+	}
+	struct arena_chunk *chunk = (struct arena_chunk*) malloc(sizeof(struct arena_chunk) + chunk_size);
+	CHECK(chunk, "fail to allocate an arena chunk of %zu bytes", chunk_size);
+	chunk->prev = arena->head;
+	chunk->size = chunk_size;
+	arena->head = chunk;
+	arena->ptr = chunk->data;
+	arena->end = chunk->data + chunk_size;
+	++arena->nchunk;
+}
+
+/*
+ * Allocate 'size' bytes aligned to 'align', which must be a power of 2.
+ */
+static inline void *arena_alloc_aligned(struct arena *arena, size_t size, size_t align) {
+	assert(align > 0 && (align & (align - 1)) == 0);
+	uintptr_t p = ((uintptr_t) arena->ptr + align - 1) & ~(uintptr_t) (align - 1);
+	if (!arena->head || p > (uintptr_t) arena->end || size > (uintptr_t) arena->end - p) {
+		_arena_new_chunk(arena, size, align);
+		p = ((uintptr_t) arena->ptr + align - 1) & ~(uintptr_t) (align - 1);
+	}
+	arena->ptr = (char*) p + size;
+	return (void*) p;
+}
+
+static inline void *arena_alloc(struct arena *arena, size_t size) {
+	return arena_alloc_aligned(arena, size, ARENA_DEFAULT_ALIGN);
+}
+
+static inline void *arena_calloc(struct arena *arena, size_t n, size_t size) {
+	CHECK(size == 0 || n <= SIZE_MAX / size, "allocation size overflow: %zu x %zu bytes", n, size);
+	void *ptr = arena_alloc(arena, n * size);
+	memset(ptr, 0, n * size);
+	return ptr;
+}
+
+/*
+ * lenstrdup with memory from the arena.
+ */
+static inline char *arena_lenstrdup(struct arena *arena, const char *src, size_t len) {
+	char *dst = (char*) arena_alloc_aligned(arena, len + 1, 1);
+	memcpy(dst, src, len);
+	dst[len] = '\0';
+	return dst;
+}
+
+static inline char *arena_strdup(struct arena *arena, const char *src) {
+	return arena_lenstrdup(arena, src, strlen(src));
+}
+
+static inline struct arena_mark arena_mark(struct arena *arena) {
+	struct arena_mark mark;
+	mark.chunk = arena->head;
+	mark.ptr = arena->ptr;
+	return mark;
+}
+
+/*
+ * Drop everything allocated after 'mark' was taken. Chunks started since then
+ * are freed.
+ */
+static inline void arena_rewind(struct arena *arena, struct arena_mark mark) {
+	while (arena->head != mark.chunk) {
+		assert(arena->head);
+		struct arena_chunk *prev = arena->head->prev;
+		free(arena->head);
+		arena->head = prev;
+		--arena->nchunk;
+	}
+	arena->ptr = mark.ptr;
+	arena->end = arena->head ? arena->head->data + arena->head->size : NULL;
+}
+
+/*
+ * Free all the chunks. The arena can be used again afterwards.
+ */
+static inline void arena_release(struct arena *arena) {
+	struct arena_mark empty = {NULL, NULL};
+	arena_rewind(arena, empty);
+}
+
+/*
+ * The allocator interface. Each block is preceded by a header holding its
+ * size so realloc knows how much to copy.
+ */
+#define _ARENA_HEADER_SIZE ARENA_DEFAULT_ALIGN
+
+static inline size_t *_arena_block_size(void *ptr) {
+	return (size_t*) ((char*) ptr - sizeof(size_t));
+}
+
+static void *_arena_alloc_fn(void *ctx, size_t size) {
+	struct arena *arena = (struct arena*) ctx;
+	CHECK(size <= SIZE_MAX - _ARENA_HEADER_SIZE, "arena allocation too large: %zu bytes", size);
+	char *ptr = (char*) arena_alloc(arena, _ARENA_HEADER_SIZE + size) + _ARENA_HEADER_SIZE;
+	*_arena_block_size(ptr) = size;
+	return ptr;
+}
+
+static void *_arena_realloc_fn(void *ctx, void *ptr, size_t size) {
+	struct arena *arena = (struct arena*) ctx;
+	if (!ptr) {
+		return _arena_alloc_fn(ctx, size);
+	}
+	size_t oldsize = *_arena_block_size(ptr);
+	if (size <= oldsize) {
+		return ptr;
+	}
+	// the last block grows in place, as a growing vec or str usually is
+	if ((char*) ptr + oldsize == arena->ptr && size - oldsize <= (size_t) (arena->end - arena->ptr)) {
+		arena->ptr += size - oldsize;
+		*_arena_block_size(ptr) = size;
+		return ptr;
+	}
+	void *newptr = _arena_alloc_fn(ctx, size);
+	memcpy(newptr, ptr, oldsize);
+	return newptr;
+}
+
+static void _arena_free_fn(void *ctx, void *ptr) {
+}
@@ -0,0 +1,175 @@
+#pragma once
+
+/*
+ * A byte buffer kept as a list of fixed-size blocks, for big outputs such as
+ * the .text of a large link.
+ *
+ * Unlike struct str, growing never moves the bytes: a full block is followed
+ * by a new one, so there is no realloc copy and no moment where the old and
+ * new buffer both exist. Bytes are addressed by offset (chunkbuf_patch,
+ * chunkbuf_at), e.g. to apply relocations after the code is emitted, and the
+ * whole buffer is written out with writev without flattening it.
+ */
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include <unistd.h>
+#include <sys/uio.h>
+#include "scom/check.h"
+#include "scom/vec.h"
+
+#define CHUNKBUF_DEFAULT_BLOCK_SIZE (64 * 1024)
+
+#ifndef IOV_MAX
+#define IOV_MAX 1024
+#endif
+
+struct chunkbuf {
+	struct vec blocks; // char*. Each of block_size bytes.
+	size_t block_size; // power of 2
+	int block_shift; // log2(block_size)
+	size_t len;
+};
+
+/*
+ * block_size must be a power of 2. 0 for CHUNKBUF_DEFAULT_BLOCK_SIZE.
+ * Nothing is allocated until bytes are added.
+ */
+static inline struct chunkbuf chunkbuf_create(size_t block_size) {
+	if (block_size == 0) {
+		block_size = CHUNKBUF_DEFAULT_BLOCK_SIZE;
+	}
+	assert((block_size & (block_size - 1)) == 0);
+	struct chunkbuf cb;
+	cb.blocks = vec_create(sizeof(char*));
+	cb.blocks.should_free_each_item = true;
+	cb.block_size = block_size;
+	cb.block_shift = __builtin_ctzll(block_size);
+	cb.len = 0;
+	return cb;
+}
+
+static inline void chunkbuf_free(struct chunkbuf *cb) {
+	vec_free(&cb->blocks);
+	cb->len = 0;
+}
+
+static inline char *_chunkbuf_block(struct chunkbuf *cb, size_t idx) {
+	return ((char**) cb->blocks.data)[idx];
+}
+
+/*
+ * Make sure n bytes in total fit without allocating.
+ */
+static inline void chunkbuf_reserve(struct chunkbuf *cb, size_t n) {
+	size_t nblock = (n + cb->block_size - 1) >> cb->block_shift;
+	if (nblock <= cb->blocks.len) {
+		return;
+	}
+	while (cb->blocks.len < nblock) {
+		char *block = (char*) malloc(cb->block_size);
+		CHECK(block, "fail to allocate a block of %zu bytes", cb->block_size);
+		vec_append(&cb->blocks, &block);
+	}
+}
+
+/*
+ * Pointer to the byte at 'off'. The bytes up to the end of its block,
+ * chunkbuf_contiguous(cb, off) of them, follow it in memory.
+ */
+static inline char *chunkbuf_at(struct chunkbuf *cb, size_t off) {
+	assert(off < cb->len);
+	return _chunkbuf_block(cb, off >> cb->block_shift) + (off & (cb->block_size - 1));
+}
+
+static inline size_t chunkbuf_contiguous(struct chunkbuf *cb, size_t off) {
+	size_t n = cb->block_size - (off & (cb->block_size - 1));
+	return n < cb->len - off ? n : cb->len - off;
+}
+
+/*
+ * Overwrite the n bytes at 'off', which must already be in the buffer.
+ */
+static inline void chunkbuf_patch(struct chunkbuf *cb, size_t off, const void *data, size_t n) {
+	CHECK(off <= cb->len && n <= cb->len - off, "chunkbuf patch out of range: offset %zu, size %zu, len %zu", off, n, cb->len);
+	const char *src = (const char*) data;
+	while (n > 0) {
+		size_t step = chunkbuf_contiguous(cb, off);
+		step = step < n ? step : n;
+		memcpy(chunkbuf_at(cb, off), src, step);
+		off += step;
+		src += step;
+		n -= step;
+	}
+}
+
+/*
+ * Copy the n bytes at 'off' to 'out'.
+ */
+static inline void chunkbuf_read(struct chunkbuf *cb, size_t off, void *out, size_t n) {
+	CHECK(off <= cb->len && n <= cb->len - off, "chunkbuf read out of range: offset %zu, size %zu, len %zu", off, n, cb->len);
+	char *dst = (char*) out;
+	while (n > 0) {
+		size_t step = chunkbuf_contiguous(cb, off);
+		step = step < n ? step : n;
+		memcpy(dst, chunkbuf_at(cb, off), step);
+		off += step;
+		dst += step;
+		n -= step;
+	}
+}
+
+/*
+ * Append n bytes and return the offset they are written at.
+ */
+static inline size_t chunkbuf_append(struct chunkbuf *cb, const void *data, size_t n) {
+	size_t off = cb->len;
+	CHECK(n <= SIZE_MAX - cb->len, "chunkbuf length overflow");
+	chunkbuf_reserve(cb, cb->len + n);
+	cb->len += n;
+	chunkbuf_patch(cb, off, data, n);
+	return off;
+}
+
+/*
+ * Append 'ch' n times and return the offset of the first one.
+ */
+static inline size_t chunkbuf_fill(struct chunkbuf *cb, size_t n, char ch) {
+	size_t off = cb->len;
+	CHECK(n <= SIZE_MAX - cb->len, "chunkbuf length overflow");
+	chunkbuf_reserve(cb, cb->len + n);
+	cb->len += n;
+	for (size_t pos = off; pos < cb->len; ) {
+		size_t step = chunkbuf_contiguous(cb, pos);
+		memset(chunkbuf_at(cb, pos), ch, step);
+		pos += step;
+	}
+	return off;
+}
+
+/*
+ * Write all the bytes to 'fd' at its current position with writev, IOV_MAX
+ * blocks per call.
+ */
+static inline void chunkbuf_writev(struct chunkbuf *cb, int fd) {
+	struct iovec iov[IOV_MAX];
+	size_t off = 0;
+	while (off < cb->len) {
+		int niov = 0;
+		for (size_t pos = off; pos < cb->len && niov < IOV_MAX; ++niov) {
+			iov[niov].iov_base = chunkbuf_at(cb, pos);
+			iov[niov].iov_len = chunkbuf_contiguous(cb, pos);
+			pos += iov[niov].iov_len;
+		}
+		ssize_t n = writev(fd, iov, niov);
+		if (n < 0 && errno == EINTR) {
+			continue;
+		}
+		CHECK(n > 0, "writev fail: %s", strerror(errno));
+		// a short write resumes from where it stopped
+		off += n;
+	}
+}
@@ -0,0 +1,240 @@
+#pragma once
+
+/*
+ * A thread-safe dictionary for read-mostly workloads like resolving symbols
+ * from many object files in parallel.
+ *
+ * The keys are spread over 2^nshard_log2 shards picked by the high bits of
+ * the hash. Each shard is an open addressing table with linear probing and
+ * its own mutex:
+ * - writers (cdict_put, cdict_put_if_absent) take the shard mutex.
+ * - readers (cdict_find) never lock. A slot is published by a release store
+ *   of its key after the value and hash are written, and a grown table is
+ *   published by a release store of the table pointer after all entries are
+ *   copied. Replaced tables are retired rather than freed until cdict_free,
+ *   so a reader still probing an old table reads valid memory and sees every
+ *   key inserted before the table was replaced.
+ *
+ * Differences from struct dict:
+ * - no deletion.
+ * - keys must not be NULL since a NULL key marks a free slot.
+ * - values are never freed by the dict. If should_free_key is set, the dict
+ *   owns the keys: a key passed to put/put_if_absent that is already present
+ *   is freed right away and the stored key is kept, since readers may be
+ *   comparing against it.
+ */
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <assert.h>
+#include <pthread.h>
+#include "scom/util.h"
+#include "scom/vec.h"
+#include "scom/dict.h"
+
+#define CDICT_CACHE_LINE 64
+
+struct cdict_entry {
+	void *key; // NULL for free slots
+	void *val;
+	uint32_t hash;
+};
+
+struct cdict_table {
+	int capacity; // power of 2
+	struct cdict_entry entries[];
+};
+
+struct cdict_shard {
+	pthread_mutex_t lock; // serializes writers of this shard
+	struct cdict_table *table;
+	int size;
+	struct vec retired; // struct cdict_table*. Replaced tables.
+} __attribute__((aligned(CDICT_CACHE_LINE)));
+
+struct cdict {
+	struct cdict_shard *shards;
+	int nshard_log2;
+	hash_fn_t hash_fn;
+	eq_fn_t eq_fn;
+	bool should_free_key;
+};
+
+static struct cdict_table *_cdict_table_create(int capacity) {
+	struct cdict_table *table = (struct cdict_table*) calloc(1, sizeof(struct cdict_table) + capacity * sizeof(struct cdict_entry));
+	table->capacity = capacity;
+	return table;
+}
+
+static struct cdict cdict_create(hash_fn_t hash_fn, eq_fn_t eq_fn, bool should_free_key, int nshard_log2) {
+	assert(hash_fn);
+	assert(eq_fn);
+	assert(nshard_log2 >= 0 && nshard_log2 <= 16);
+	struct cdict cd;
+	cd.nshard_log2 = nshard_log2;
+	cd.hash_fn = hash_fn;
+	cd.eq_fn = eq_fn;
+	cd.should_free_key = should_free_key;
+	int nshard = 1 << nshard_log2;
+	void *shards = NULL;
+	int rc = posix_memalign(&shards, CDICT_CACHE_LINE, nshard * sizeof(struct cdict_shard));
+	CHECK(rc == 0, "fail to allocate %d shards", nshard);
+	cd.shards = (struct cdict_shard*) shards;
+	for (int i = 0; i < nshard; ++i) {
+		struct cdict_shard *shard = &cd.shards[i];
+		pthread_mutex_init(&shard->lock, NULL);
+		shard->table = _cdict_table_create(16);
+		shard->size = 0;
+		shard->retired = vec_create(sizeof(struct cdict_table*));
+	}
+	return cd;
+}
+
+static void cdict_free(struct cdict *cd) {
+	for (int i = 0; i < (1 << cd->nshard_log2); ++i) {
+		struct cdict_shard *shard = &cd->shards[i];
+		if (cd->should_free_key) {
+			for (int j = 0; j < shard->table->capacity; ++j) {
+				free(shard->table->entries[j].key);
+			}
+		}
+		free(shard->table);
+		VEC_FOREACH(&shard->retired, struct cdict_table*, table) {
+			free(*table);
+		}
+		vec_free(&shard->retired);
+		pthread_mutex_destroy(&shard->lock);
+	}
+	free(cd->shards);
+	cd->shards = NULL;
+}
+
+static inline struct cdict_shard *_cdict_shard(struct cdict *cd, uint32_t hash) {
+	// the high bits pick the shard, the low bits pick the slot in the shard
+	return &cd->shards[cd->nshard_log2 == 0 ? 0 : hash >> (32 - cd->nshard_log2)];
+}
+
+/*
+ * Probe for key in table. Return the entry holding the key, or the free entry
+ * the key should go to. The key loaded from the returned entry is stored to
+ * *pfound: NULL for a free entry. A lock-free reader must decide hit or miss
+ * from it, since a writer may fill a free entry right after it is loaded.
+ */
+static struct cdict_entry *_cdict_probe(struct cdict *cd, struct cdict_table *table, void *key, uint32_t hash, void **pfound) {
+	int mask = table->capacity - 1;
+	for (int idx = hash & mask; ; idx = (idx + 1) & mask) {
+		struct cdict_entry *entry = &table->entries[idx];
+		void *entry_key = __atomic_load_n(&entry->key, __ATOMIC_ACQUIRE);
+		if (!entry_key || (entry->hash == hash && cd->eq_fn(key, entry_key))) {
+			*pfound = entry_key;
+			return entry;
+		}
+	}
+}
+
+/*
+ * Look up the key without taking any lock. If found, store the value to
+ * *pval (when pval is not NULL) and return true.
+ */
+static bool cdict_find(struct cdict *cd, void *key, void **pval) {
+	uint32_t hash = cd->hash_fn(key);
+	struct cdict_shard *shard = _cdict_shard(cd, hash);
+	struct cdict_table *table = __atomic_load_n(&shard->table, __ATOMIC_ACQUIRE);
+	void *found;
+	struct cdict_entry *entry = _cdict_probe(cd, table, key, hash, &found);
+	if (!found) {
+		return false;
+	}
+	if (pval) {
+		*pval = __atomic_load_n(&entry->val, __ATOMIC_ACQUIRE);
+	}
+	return true;
+}
+
+/*
+ * Double the table of a shard. Caller holds the shard lock.
+ */
+static void _cdict_expand(struct cdict *cd, struct cdict_shard *shard) {
+	struct cdict_table *old = shard->table;
+	struct cdict_table *table = _cdict_table_create(old->capacity << 1);
+	int mask = table->capacity - 1;
+	for (int i = 0; i < old->capacity; ++i) {
+		struct cdict_entry *src = &old->entries[i];
+		if (src->key) {
+			int idx = src->hash & mask;
+			while (table->entries[idx].key) {
+				idx = (idx + 1) & mask;
+			}
+			table->entries[idx] = *src;
+		}
+	}
+	__atomic_store_n(&shard->table, table, __ATOMIC_RELEASE);
+	// readers may still be probing the old table
+	vec_append(&shard->retired, &old);
+}
+
+/*
+ * Insert or update under the shard lock. If only_if_absent is set, an
+ * existing value is left alone and returned to *pexisting.
+ * Return the number of entries created.
+ */
+static int _cdict_put(struct cdict *cd, void *key, void *val, bool only_if_absent, void **pexisting) {
+	uint32_t hash = cd->hash_fn(key);
+	struct cdict_shard *shard = _cdict_shard(cd, hash);
+	pthread_mutex_lock(&shard->lock);
+	if ((shard->size + 1) * 2 > shard->table->capacity) {
+		_cdict_expand(cd, shard);
+	}
+	void *found;
+	struct cdict_entry *entry = _cdict_probe(cd, shard->table, key, hash, &found);
+	int created = 0;
+	if (found) {
+		if (pexisting) {
+			*pexisting = entry->val;
+		}
+		if (!only_if_absent) {
+			__atomic_store_n(&entry->val, val, __ATOMIC_RELEASE);
+		}
+		if (cd->should_free_key && key != found) {
+			free(key);
+		}
+	} else {
+		entry->val = val;
+		entry->hash = hash;
+		// publish the slot last
+		__atomic_store_n(&entry->key, key, __ATOMIC_RELEASE);
+		__atomic_add_fetch(&shard->size, 1, __ATOMIC_RELAXED);
+		created = 1;
+	}
+	pthread_mutex_unlock(&shard->lock);
+	return created;
+}
+
+/*
+ * Insert if the key is not added yet; update if the key already exits.
+ * Return the number of entries created.
+ */
+static int cdict_put(struct cdict *cd, void *key, void *val) {
+	return _cdict_put(cd, key, val, false, NULL);
+}
+
+/*
+ * Atomically insert the key only if it is absent, e.g. for first-definition
+ * wins symbol resolution. Return 1 if inserted. Otherwise return 0 and store
+ * the existing value to *pexisting (when pexisting is not NULL).
+ */
+static int cdict_put_if_absent(struct cdict *cd, void *key, void *val, void **pexisting) {
+	return _cdict_put(cd, key, val, true, pexisting);
+}
+
+/*
+ * Number of entries. Only exact when no writer is running.
+ */
+static int cdict_size(struct cdict *cd) {
+	int size = 0;
+	for (int i = 0; i < (1 << cd->nshard_log2); ++i) {
+		size += __atomic_load_n(&cd->shards[i].size, __ATOMIC_RELAXED);
+	}
+	return size;
+}
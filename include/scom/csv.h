@@ -0,0 +1,192 @@
+#pragma once
+
+/*
+ * Split comma (or other delimiter) separated lists such as export lists and
+ * option values into string views, without copying the fields.
+ *
+ * The fields follow vec_create_from_csv: leading spaces of a field are
+ * skipped, spaces inside or after it are kept and empty fields are dropped.
+ *
+ * Delimiters are searched 16 bytes at a time with SSE2, or 32 with AVX2 when
+ * the code is built with -mavx2.
+ *
+ * csv_stream takes the input in chunks, e.g. as it is read from a file.
+ */
+
+#include <stdint.h>
+#include <ctype.h>
+#include "scom/strview.h"
+#include "scom/vec.h"
+#include "scom/str.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+typedef void (*csv_field_fn)(void *ctx, struct strview field);
+
+/*
+ * Report the field [l, r) unless it is empty after skipping leading spaces.
+ */
+static inline void _csv_emit(const char *l, const char *r, csv_field_fn fn, void *ctx) {
+	while (l < r && isspace((unsigned char) *l)) {
+		++l;
+	}
+	if (l < r) {
+		fn(ctx, strview_create(l, r - l));
+	}
+}
+
+/*
+ * Bit i of the result is set if p[i] is 'delim'. Loads CSV_BLOCK_SIZE bytes.
+ */
+#if defined(__AVX2__)
+#define CSV_BLOCK_SIZE 32
+static inline uint32_t _csv_match_block(const char *p, char delim) {
+	__m256i block = _mm256_loadu_si256((const __m256i*) p);
+	return (uint32_t) _mm256_movemask_epi8(_mm256_cmpeq_epi8(block, _mm256_set1_epi8(delim)));
+}
+#elif defined(__SSE2__)
+#define CSV_BLOCK_SIZE 16
+static inline uint32_t _csv_match_block(const char *p, char delim) {
+	__m128i block = _mm_loadu_si128((const __m128i*) p);
+	return (uint32_t) _mm_movemask_epi8(_mm_cmpeq_epi8(block, _mm_set1_epi8(delim)));
+}
+#endif
+
+/*
+ * Return the first 'delim' in [p, end), or end if there is none.
+ */
+static inline const char *_csv_find(const char *p, const char *end, char delim) {
+#ifdef CSV_BLOCK_SIZE
+	for (; end - p >= CSV_BLOCK_SIZE; p += CSV_BLOCK_SIZE) {
+		uint32_t mask = _csv_match_block(p, delim);
+		if (mask) {
+			return p + __builtin_ctz(mask);
+		}
+	}
+#endif
+	for (; p < end; ++p) {
+		if (*p == delim) {
+			break;
+		}
+	}
+	return p;
+}
+
+/*
+ * Report every field of [p, end) that is terminated by 'delim' and return
+ * the start of the trailing unterminated one.
+ */
+static inline const char *_csv_scan(const char *p, const char *end, char delim, csv_field_fn fn, void *ctx) {
+	const char *field = p;
+#ifdef CSV_BLOCK_SIZE
+	for (; end - p >= CSV_BLOCK_SIZE; p += CSV_BLOCK_SIZE) {
+		uint32_t mask = _csv_match_block(p, delim);
+		while (mask) {
+			const char *q = p + __builtin_ctz(mask);
+			_csv_emit(field, q, fn, ctx);
+			field = q + 1;
+			mask &= mask - 1;
+		}
+	}
+#endif
+	for (; p < end; ++p) {
+		if (*p == delim) {
+			_csv_emit(field, p, fn, ctx);
+			field = p + 1;
+		}
+	}
+	return field;
+}
+
+/*
+ * Call fn for each field of buf[0, len). The views point into buf.
+ */
+static inline void csv_split(const char *buf, size_t len, char delim, csv_field_fn fn, void *ctx) {
+	const char *end = buf + len;
+	const char *last = _csv_scan(buf, end, delim, fn, ctx);
+	_csv_emit(last, end, fn, ctx);
+}
+
+static void _csv_append_view(void *ctx, struct strview field) {
+	vec_append((struct vec*) ctx, &field);
+}
+
+/*
+ * Append a struct strview to 'views' for each field of buf[0, len).
+ */
+static inline void csv_split_to_vec(const char *buf, size_t len, char delim, struct vec *views) {
+	assert(views->itemsize == sizeof(struct strview));
+	csv_split(buf, len, delim, _csv_append_view, views);
+}
+
+/*
+ * The zero-copy counterpart of vec_create_from_csv: a vec of struct strview
+ * pointing into 'csv', which must outlive the vec. Only the vec itself needs
+ * to be freed.
+ */
+static inline struct vec vec_create_views_from_csv(const char *csv) {
+	struct vec views = vec_create(sizeof(struct strview));
+	csv_split_to_vec(csv, strlen(csv), ',', &views);
+	return views;
+}
+
+/*
+ * Split input arriving in chunks:
+ *
+ *   struct csv_stream stream = csv_stream_create(',', on_field, ctx);
+ *   while ((n = read(fd, buf, sizeof(buf))) > 0) {
+ *     csv_stream_feed(&stream, buf, n);
+ *   }
+ *   csv_stream_finish(&stream);
+ *
+ * Fields inside a chunk are reported as views into the chunk. Only a field
+ * spanning chunks is copied, into 'pending'. Either way a view is only valid
+ * during the callback.
+ */
+struct csv_stream {
+	char delim;
+	csv_field_fn fn;
+	void *ctx;
+	// start of a field whose delimiter has not arrived yet
+	struct str pending;
+};
+
+static inline struct csv_stream csv_stream_create(char delim, csv_field_fn fn, void *ctx) {
+	struct csv_stream stream;
+	stream.delim = delim;
+	stream.fn = fn;
+	stream.ctx = ctx;
+	stream.pending = str_create(0);
+	return stream;
+}
+
+static inline void csv_stream_feed(struct csv_stream *stream, const char *chunk, size_t len) {
+	const char *end = chunk + len;
+	const char *first = _csv_find(chunk, end, stream->delim);
+	if (first == end) {
+		str_lenconcat(&stream->pending, chunk, len);
+		return;
+	}
+	if (stream->pending.len > 0) {
+		str_lenconcat(&stream->pending, chunk, first - chunk);
+		_csv_emit(stream->pending.buf, stream->pending.buf + stream->pending.len, stream->fn, stream->ctx);
+		stream->pending.len = 0;
+	} else {
+		_csv_emit(chunk, first, stream->fn, stream->ctx);
+	}
+	const char *last = _csv_scan(first + 1, end, stream->delim, stream->fn, stream->ctx);
+	str_lenconcat(&stream->pending, last, end - last);
+}
+
+/*
+ * Report the last field and free the stream. Call it after the last chunk.
+ */
+static inline void csv_stream_finish(struct csv_stream *stream) {
+	_csv_emit(stream->pending.buf, stream->pending.buf + stream->pending.len, stream->fn, stream->ctx);
+	str_free(&stream->pending);
+	stream->pending.len = 0;
+}
@@ -18,8 +18,48 @@
  *   - an alternative is that we enable the library storing a struct inline.
  *     That can save some malloc calls but make the API complex
  *     and may also be bad for cache locality.
- * TODO: does not support deletion yet since there is no such usage in my
- * other projects using this library yet. They may be added when needed.
+ *
+ * Three layouts are supported. All share the same entry type and the same
+ * put/find/remove/iteration API:
+ * - DICT_LINEAR: Robin Hood linear probing. An insertion takes the slot of
+ *   the first entry that is closer to its home slot than the new key, and
+ *   shifts the rest of the cluster back by one. dict_remove shifts the
+ *   following entries forward instead of leaving a tombstone. So probe
+ *   lengths stay short under churn and a miss can stop as soon as it passes
+ *   an entry closer to home than itself. This is the default.
+ * - DICT_SWISS: besides the entries, keep an array of 1-byte control tags
+ *   (7 bits of the hash for allocated slots, or EMPTY/DELETED). A group of
+ *   DICT_GROUP_WIDTH tags is probed at once (with SSE2 if available) and
+ *   eq_fn is only called for slots whose tag matches. dict_remove leaves a
+ *   DELETED tag which is cleaned up by the next resize.
+ * - DICT_COMPACT: entries are appended to a dense array in insertion order
+ *   and a separate array of int32_t slots, probed linearly, indexes into it.
+ *   Iteration only walks the entries in use, in insertion order. dict_remove
+ *   leaves a hole in the entries (and backward-shifts the index) which is
+ *   squeezed out by the next resize. Since a resize moves entries in order,
+ *   a compact dict always rehashes in one go and ignores
+ *   dict_set_incremental_rehash.
+ *
+ * String keys hash with a word-at-a-time hash from hash.h by default
+ * (str_hash_fn). A CRC32C based variant is also available, and a dict can be
+ * switched to a seeded hash with a random per-dict seed
+ * (dict_use_seeded_hash) so crafted keys can't force collisions.
+ *
+ * Each entry caches the 32 bit hash of its key. Growing the table never calls
+ * hash_fn again, and probing skips entries with a different hash without
+ * calling eq_fn.
+ *
+ * By default growing the table moves all entries in one go inside the
+ * dict_put that triggers it. With dict_set_incremental_rehash the old table
+ * is kept around instead and each following put/find migrates at most
+ * DICT_REHASH_STEP slots, so no single operation pays for the whole table.
+ *
+ * dict_create_with_alloc makes the dict take its tables from an allocator
+ * (alloc.h) instead of libc.
+ *
+ * Building with -DDICT_STATS makes each dict count finds, eq_fn calls, probe
+ * lengths and resizes (see struct dict_stats). Without it the counters are
+ * compiled out and dict_stats_get returns zeros.
  */
 
 #include <stdlib.h>
@@ -28,6 +68,17 @@
 #include <assert.h>
 #include <stdio.h>
 #include "util.h"
+#include "hash.h"
+#include "alloc.h"
+#include "strview.h"
+
+#ifdef DICT_STATS
+#include <time.h>
+#endif
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 #define DICT_FOREACH(dict_ptr, entry_ptr) \
   for (struct dict_entry *entry_ptr = dict_begin(dict_ptr); \
@@ -45,16 +96,71 @@ enum {
 	ALLOCATED, // allocated slot
 };
 
+enum dict_layout {
+	DICT_LINEAR = 0,
+	DICT_SWISS,
+	DICT_COMPACT,
+};
+
+/*
+ * Control tags for DICT_SWISS. An allocated slot stores the low 7 bits of the
+ * hash so the high bit tells apart allocated and free slots.
+ */
+#define DICT_CTRL_EMPTY ((uint8_t) 0x80)
+#define DICT_CTRL_DELETED ((uint8_t) 0xFE)
+#define DICT_GROUP_WIDTH 16
+
+// a free DICT_COMPACT index slot
+#define DICT_INDEX_EMPTY (-1)
+
+// number of old table slots migrated per put/find in incremental rehash mode
+#define DICT_REHASH_STEP 64
+
+// number of keys dict_find_batch hashes and prefetches ahead of probing
+#define DICT_BATCH_SIZE 16
+
 struct dict_entry {
 	void *key, *val;
+	uint32_t hash; // cached hash of key
 	int flags;
 };
 
+// the last bucket of the probe histogram collects all longer probes
+#define DICT_PROBE_HIST_SIZE 16
+
+struct dict_stats {
+	uint64_t nfind; // dict_find calls
+	uint64_t nhit;
+	uint64_t nmiss;
+	uint64_t neq; // eq_fn calls while probing
+	// probe_hist[i] counts probe sequences (of finds, puts, removes and
+	// rehashing) that went i slots past the home slot. For DICT_SWISS, i
+	// counts groups instead of slots.
+	uint64_t probe_hist[DICT_PROBE_HIST_SIZE];
+	uint64_t nexpand; // _dict_expand calls
+	uint64_t expand_ns; // time spent in _dict_expand
+	int peak_capacity;
+};
+
+#ifdef DICT_STATS
+#define _DICT_STAT(stmt) do { stmt; } while (0)
+#define _DICT_EQ_WITH(dict, eq_fn, lhs, rhs) (++(dict)->stats.neq, (eq_fn)(lhs, rhs))
+#else
+#define _DICT_STAT(stmt) do { } while (0)
+#define _DICT_EQ_WITH(dict, eq_fn, lhs, rhs) ((eq_fn)(lhs, rhs))
+#endif
+#define _DICT_EQ(dict, lhs, rhs) _DICT_EQ_WITH(dict, (dict)->eq_fn, lhs, rhs)
+
 typedef uint32_t (*hash_fn_t)(void *key);
+typedef uint32_t (*seeded_hash_fn_t)(void *key, uint64_t seed);
 // return truth value iff lhs 'equals' rhs
 typedef bool (*eq_fn_t)(void *lhs, void* rhs);
 
-static uint32_t str_hash_fn(void *_key) {
+/*
+ * The original byte-at-a-time string hash. Kept for comparison in the
+ * benchmarks.
+ */
+static uint32_t str_hash_mul23_fn(void *_key) {
 	const char* key = (const char*) _key;
   uint32_t h = 0;
   for (int i = 0; key[i]; ++i) {
@@ -63,6 +169,24 @@ static uint32_t str_hash_fn(void *_key) {
   return h;
 }
 
+static uint32_t str_hash_seeded_fn(void *_key, uint64_t seed) {
+	const char* key = (const char*) _key;
+	return _hash_fold32(hash_bytes(key, strlen(key), seed));
+}
+
+static uint32_t str_hash_fn(void *key) {
+	return str_hash_seeded_fn(key, 0);
+}
+
+static uint32_t str_crc32c_seeded_fn(void *_key, uint64_t seed) {
+	const char* key = (const char*) _key;
+	return hash_crc32c(key, strlen(key), (uint32_t) seed);
+}
+
+static uint32_t str_crc32c_fn(void *key) {
+	return str_crc32c_seeded_fn(key, 0);
+}
+
 static bool str_eq_fn(void* _lhs, void* _rhs) {
 	const char* lhs = (const char*) _lhs;
 	const char* rhs = (const char*) _rhs;
@@ -74,25 +198,179 @@ struct dict {
 	int size;
 	int capacity;
 	hash_fn_t hash_fn;
+	// if set, used instead of hash_fn
+	seeded_hash_fn_t seeded_hash_fn;
+	uint64_t seed;
 	eq_fn_t eq_fn;
 	bool should_free_key;
 	bool should_free_val;
+	int layout; // enum dict_layout
+	// the table grows once size (plus DELETED tags) reaches this percentage
+	// of capacity
+	int max_load_pct;
+	// where the tables come from and where owned keys/vals are released to.
+	// NULL for libc.
+	struct allocator* alloc;
+
+	// DICT_SWISS only. capacity + DICT_GROUP_WIDTH - 1 control tags. The tags
+	// for the first DICT_GROUP_WIDTH - 1 slots are mirrored after the end so
+	// a group can always be loaded without wrapping around.
+	uint8_t *ctrl;
+	// DICT_SWISS: number of DELETED tags. DICT_COMPACT: number of holes in
+	// entries left by dict_remove.
+	int ndeleted;
+
+	// DICT_COMPACT only. 'capacity' slots holding an index into entries or
+	// DICT_INDEX_EMPTY. Entries [0, size + ndeleted) are in use.
+	int32_t *index;
+
+	bool incremental_rehash;
+	// When an incremental rehash is in progress, the old table is kept in
+	// rehash_src and slots below rehash_idx have been migrated. 'size' covers
+	// entries in both tables while rehash_src->size only counts the old one.
+	struct dict* rehash_src;
+	int rehash_idx;
+
+#ifdef DICT_STATS
+	// probes into the old table of an incremental rehash are not counted
+	struct dict_stats stats;
+#endif
 };
 
-static struct dict dict_create(hash_fn_t hash_fn, eq_fn_t eq_fn, bool should_free_key, bool should_free_val) {
+static uint8_t *_dict_alloc_ctrl(struct allocator* alloc, int capacity) {
+	uint8_t *ctrl = (uint8_t*) alloc_malloc(alloc, capacity + DICT_GROUP_WIDTH - 1);
+	memset(ctrl, DICT_CTRL_EMPTY, capacity + DICT_GROUP_WIDTH - 1);
+	return ctrl;
+}
+
+static int32_t *_dict_alloc_index(struct allocator* alloc, int capacity) {
+	int32_t *index = (int32_t*) alloc_malloc(alloc, sizeof(int32_t) * capacity);
+	memset(index, 0xFF, sizeof(int32_t) * capacity); // DICT_INDEX_EMPTY
+	return index;
+}
+
+/*
+ * Length of the entries array. DICT_COMPACT only needs room for entries up to
+ * the load limit.
+ */
+static int _dict_entries_capacity(int layout, int capacity, int max_load_pct) {
+	if (layout == DICT_COMPACT) {
+		return (int64_t) capacity * max_load_pct / 100 + 1;
+	}
+	return capacity;
+}
+
+/*
+ * Number of entries to walk when visiting all of them.
+ */
+static inline int _dict_nentry(struct dict* dict) {
+	return dict->layout == DICT_COMPACT ? dict->size + dict->ndeleted : dict->capacity;
+}
+
+/*
+ * Smallest power of 2 capacity that keeps n entries under max_load_pct.
+ */
+static int _dict_capacity_for(int n, int max_load_pct) {
+	int capacity = DICT_GROUP_WIDTH;
+	while ((int64_t) n * 100 >= (int64_t) capacity * max_load_pct) {
+		capacity <<= 1;
+	}
+	return capacity;
+}
+
+static struct dict _dict_create(int layout, hash_fn_t hash_fn, eq_fn_t eq_fn, bool should_free_key, bool should_free_val, int capacity, struct allocator* alloc) {
 	struct dict dict;
 	dict.size = 0;
-	dict.capacity = 64;
-	dict.entries = (struct dict_entry*) calloc(dict.capacity, sizeof(struct dict_entry));
+	dict.capacity = capacity;
+	dict.alloc = alloc;
 	assert(hash_fn);
 	assert(eq_fn);
 	dict.hash_fn = hash_fn;
+	dict.seeded_hash_fn = NULL;
+	dict.seed = 0;
 	dict.eq_fn = eq_fn;
 	dict.should_free_key = should_free_key;
 	dict.should_free_val = should_free_val;
+	dict.layout = layout;
+	// the tags keep DICT_SWISS probing cheap so allow the table to be 7/8 full
+	dict.max_load_pct = layout == DICT_SWISS ? 87 : 50;
+	dict.entries = (struct dict_entry*) alloc_calloc(alloc, _dict_entries_capacity(layout, capacity, dict.max_load_pct), sizeof(struct dict_entry));
+	dict.ctrl = layout == DICT_SWISS ? _dict_alloc_ctrl(alloc, capacity) : NULL;
+	dict.ndeleted = 0;
+	dict.index = layout == DICT_COMPACT ? _dict_alloc_index(alloc, capacity) : NULL;
+	dict.incremental_rehash = false;
+	dict.rehash_src = NULL;
+	dict.rehash_idx = 0;
+#ifdef DICT_STATS
+	memset(&dict.stats, 0, sizeof(dict.stats));
+	dict.stats.peak_capacity = capacity;
+#endif
 	return dict;
 }
 
+/*
+ * Create a dict with the given layout (enum dict_layout) that takes its
+ * memory from 'alloc' (NULL for libc). Keys and values the dict frees
+ * (should_free_key/should_free_val) are released with it too, so they should
+ * come from the same allocator.
+ */
+static struct dict dict_create_with_alloc(int layout, hash_fn_t hash_fn, eq_fn_t eq_fn, bool should_free_key, bool should_free_val, struct allocator* alloc) {
+	return _dict_create(layout, hash_fn, eq_fn, should_free_key, should_free_val, 64, alloc);
+}
+
+static struct dict dict_create(hash_fn_t hash_fn, eq_fn_t eq_fn, bool should_free_key, bool should_free_val) {
+	return dict_create_with_alloc(DICT_LINEAR, hash_fn, eq_fn, should_free_key, should_free_val, NULL);
+}
+
+/*
+ * Same as dict_create but size the table so that n entries can be inserted
+ * without growing.
+ */
+static struct dict dict_create_with_capacity(hash_fn_t hash_fn, eq_fn_t eq_fn, bool should_free_key, bool should_free_val, int n) {
+	assert(n >= 0);
+	return _dict_create(DICT_LINEAR, hash_fn, eq_fn, should_free_key, should_free_val, _dict_capacity_for(n, 50), NULL);
+}
+
+/*
+ * Same as dict_create but use the DICT_SWISS layout.
+ */
+static struct dict dict_create_swiss(hash_fn_t hash_fn, eq_fn_t eq_fn, bool should_free_key, bool should_free_val) {
+	return dict_create_with_alloc(DICT_SWISS, hash_fn, eq_fn, should_free_key, should_free_val, NULL);
+}
+
+/*
+ * Same as dict_create but use the DICT_COMPACT layout, which iterates in
+ * insertion order.
+ */
+static struct dict dict_create_compact(hash_fn_t hash_fn, eq_fn_t eq_fn, bool should_free_key, bool should_free_val) {
+	return dict_create_with_alloc(DICT_COMPACT, hash_fn, eq_fn, should_free_key, should_free_val, NULL);
+}
+
+/*
+ * Enable or disable the incremental rehash mode.
+ */
+static void dict_set_incremental_rehash(struct dict* dict, bool enable) {
+	dict->incremental_rehash = enable;
+}
+
+/*
+ * Hash keys of an empty dict with seeded_hash_fn and a random seed picked
+ * for this dict.
+ */
+static void dict_use_seeded_hash(struct dict* dict, seeded_hash_fn_t seeded_hash_fn) {
+	assert(dict->size == 0);
+	assert(seeded_hash_fn);
+	dict->seeded_hash_fn = seeded_hash_fn;
+	dict->seed = hash_random_seed();
+}
+
+static inline uint32_t _dict_hash(struct dict* dict, void *key) {
+	if (dict->seeded_hash_fn) {
+		return dict->seeded_hash_fn(key, dict->seed);
+	}
+	return dict->hash_fn(key);
+}
+
 /*
  * Create an dict with 'char*' key and int value.
  */
@@ -101,40 +379,468 @@ static struct dict dict_create_str_int() {
 }
 
 /*
- * Locate the key in the entry list.
+ * Return a bitmask with bit i set iff group[i] == tag.
+ */
+static inline uint32_t _dict_group_match(const uint8_t *group, uint8_t tag) {
+#ifdef __SSE2__
+	__m128i ctrl = _mm_loadu_si128((const __m128i*) group);
+	return (uint32_t) _mm_movemask_epi8(_mm_cmpeq_epi8(ctrl, _mm_set1_epi8((char) tag)));
+#else
+	uint32_t mask = 0;
+	for (int i = 0; i < DICT_GROUP_WIDTH; ++i) {
+		mask |= (uint32_t) (group[i] == tag) << i;
+	}
+	return mask;
+#endif
+}
+
+/*
+ * Return a bitmask with bit i set iff group[i] is EMPTY or DELETED.
+ */
+static inline uint32_t _dict_group_match_free(const uint8_t *group) {
+#ifdef __SSE2__
+	__m128i ctrl = _mm_loadu_si128((const __m128i*) group);
+	return (uint32_t) _mm_movemask_epi8(ctrl);
+#else
+	uint32_t mask = 0;
+	for (int i = 0; i < DICT_GROUP_WIDTH; ++i) {
+		mask |= (uint32_t) (group[i] >> 7) << i;
+	}
+	return mask;
+#endif
+}
+
+static inline void _dict_set_ctrl(struct dict *dict, int idx, uint8_t tag) {
+	dict->ctrl[idx] = tag;
+	if (idx < DICT_GROUP_WIDTH - 1) {
+		dict->ctrl[dict->capacity + idx] = tag;
+	}
+}
+
+#ifdef DICT_STATS
+static inline void _dict_stats_probe(struct dict* dict, int len) {
+	++dict->stats.probe_hist[len < DICT_PROBE_HIST_SIZE - 1 ? len : DICT_PROBE_HIST_SIZE - 1];
+}
+
+static inline uint64_t _dict_stats_now_ns() {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+#endif
+
+/*
+ * _dict_locate_or_reserve for DICT_SWISS. Capacity is always a power of 2 no
+ * less than DICT_GROUP_WIDTH. The high bits of the hash pick the first group
+ * and the low 7 bits are the tag.
+ */
+static struct dict_entry* _dict_swiss_locate(struct dict* dict, void *key, uint32_t hash, eq_fn_t eq_fn) {
+	uint32_t mask = dict->capacity - 1;
+	uint8_t tag = hash & 0x7F;
+	uint32_t pos = (hash >> 7) & mask;
+	struct dict_entry* first_free = NULL;
+	int probed = 0;
+	for (; probed < dict->capacity; probed += DICT_GROUP_WIDTH) {
+		const uint8_t *group = dict->ctrl + pos;
+		for (uint32_t m = _dict_group_match(group, tag); m; m &= m - 1) {
+			struct dict_entry* entry = &dict->entries[(pos + __builtin_ctz(m)) & mask];
+			if (entry->hash == hash && _DICT_EQ_WITH(dict, eq_fn, key, entry->key)) {
+				_DICT_STAT(_dict_stats_probe(dict, probed / DICT_GROUP_WIDTH));
+				return entry;
+			}
+		}
+		uint32_t free_mask = _dict_group_match_free(group);
+		if (free_mask && !first_free) {
+			first_free = &dict->entries[(pos + __builtin_ctz(free_mask)) & mask];
+		}
+		if (_dict_group_match(group, DICT_CTRL_EMPTY)) {
+			// an EMPTY slot terminates the probe sequence
+			break;
+		}
+		pos = (pos + DICT_GROUP_WIDTH) & mask;
+	}
+	_DICT_STAT(_dict_stats_probe(dict, probed / DICT_GROUP_WIDTH));
+	return first_free;
+}
+
+/*
+ * Probe the DICT_COMPACT index for key. Return the index slot pointing to its
+ * entry, or the DICT_INDEX_EMPTY slot the key would go to.
+ */
+static int32_t* _dict_compact_probe(struct dict* dict, void *key, uint32_t hash, eq_fn_t eq_fn) {
+	uint32_t mask = dict->capacity - 1;
+	for (uint32_t pos = hash & mask; ; pos = (pos + 1) & mask) {
+		int32_t *slot = &dict->index[pos];
+		if (*slot == DICT_INDEX_EMPTY
+				|| (dict->entries[*slot].hash == hash && _DICT_EQ_WITH(dict, eq_fn, key, dict->entries[*slot].key))) {
+			_DICT_STAT(_dict_stats_probe(dict, (pos - hash) & mask));
+			return slot;
+		}
+	}
+}
+
+/*
+ * Distance of the entry at slot idx from its home slot.
+ */
+static inline int _dict_probe_dist(struct dict* dict, int idx) {
+	int home = dict->entries[idx].hash % dict->capacity;
+	return idx >= home ? idx - home : idx + dict->capacity - home;
+}
+
+/*
+ * Return the ALLOCATED entry for key, or NULL if the key does not exist.
+ * Keys are compared with eq_fn(key, entry->key), which may differ from
+ * dict->eq_fn when key is not of the stored key type (see dict_find_view).
+ */
+static struct dict_entry* _dict_lookup_hashed_eq(struct dict* dict, void *key, uint32_t hash, eq_fn_t eq_fn) {
+	if (dict->layout == DICT_SWISS) {
+		struct dict_entry* entry = _dict_swiss_locate(dict, key, hash, eq_fn);
+		return entry && entry->flags == ALLOCATED ? entry : NULL;
+	}
+	if (dict->layout == DICT_COMPACT) {
+		int32_t *slot = _dict_compact_probe(dict, key, hash, eq_fn);
+		return *slot == DICT_INDEX_EMPTY ? NULL : &dict->entries[*slot];
+	}
+	int h = hash % dict->capacity;
+	for (int dist = 0; dist < dict->capacity; ++dist) {
+		struct dict_entry* entry = &dict->entries[h];
+		// Robin Hood invariant: the key would have taken the slot of any entry
+		// closer to its home than the key is.
+		if (entry->flags == FREE || _dict_probe_dist(dict, h) < dist) {
+			_DICT_STAT(_dict_stats_probe(dict, dist));
+			return NULL;
+		}
+		if (entry->hash == hash && _DICT_EQ_WITH(dict, eq_fn, key, entry->key)) {
+			_DICT_STAT(_dict_stats_probe(dict, dist));
+			return entry;
+		}
+		if (++h == dict->capacity) {
+			h = 0;
+		}
+	}
+	return NULL;
+}
+
+static struct dict_entry* _dict_lookup_hashed(struct dict* dict, void *key, uint32_t hash) {
+	return _dict_lookup_hashed_eq(dict, key, hash, dict->eq_fn);
+}
+
+/*
+ * Locate the key in the entry list, reserving a slot for it on a miss.
  * If the key exists, then return the entry allocated for it;
- * Otherwise, return the entry that should be allocated for the key if
- * we insert the key before further mutating to the dictionary.
+ * Otherwise, return the entry that should be allocated for the key.
+ *
+ * For DICT_LINEAR, a miss may shift part of a cluster back to make room for
+ * the key. For DICT_COMPACT, a miss points an index slot to the next entry to
+ * append. Either way the caller must occupy the returned FREE entry right
+ * away.
  *
  * Return NULL if the dictionary is full and the key does not exist in the
  * dictionary.
  */
-static struct dict_entry* _dict_locate(struct dict* dict, void *key) {
-	int h = dict->hash_fn(key) % dict->capacity;
-	int cnt = 0;
-	while (dict->entries[h].flags == ALLOCATED && !dict->eq_fn(key, dict->entries[h].key)) {
-		if (++cnt == dict->capacity) {
+static struct dict_entry* _dict_locate_or_reserve_hashed(struct dict* dict, void *key, uint32_t hash) {
+	if (dict->layout == DICT_SWISS) {
+		return _dict_swiss_locate(dict, key, hash, dict->eq_fn);
+	}
+	if (dict->layout == DICT_COMPACT) {
+		int32_t *slot = _dict_compact_probe(dict, key, hash, dict->eq_fn);
+		if (*slot == DICT_INDEX_EMPTY) {
+			if (_dict_nentry(dict) == _dict_entries_capacity(dict->layout, dict->capacity, dict->max_load_pct)) {
+				return NULL;
+			}
+			*slot = _dict_nentry(dict);
+		}
+		return &dict->entries[*slot];
+	}
+	int h = hash % dict->capacity;
+	int dist = 0;
+	while (dict->entries[h].flags == ALLOCATED && _dict_probe_dist(dict, h) >= dist) {
+		struct dict_entry* entry = &dict->entries[h];
+		if (entry->hash == hash && _DICT_EQ(dict, key, entry->key)) {
+			_DICT_STAT(_dict_stats_probe(dict, dist));
+			return entry;
+		}
+		if (++dist == dict->capacity) {
 			// dictionary is full and the key is not found. return NULL
 			return NULL;
 		}
-		++h;
-		if (h == dict->capacity) {
+		if (++h == dict->capacity) {
 			h = 0;
 		}
 	}
+	_DICT_STAT(_dict_stats_probe(dict, dist));
+	if (dict->entries[h].flags == ALLOCATED) {
+		// Take the slot of a richer entry: shift the rest of the cluster back by
+		// one. Every shifted entry gets one step further from home, which keeps
+		// the Robin Hood invariant.
+		int free_idx = h;
+		while (dict->entries[free_idx].flags == ALLOCATED) {
+			if (++free_idx == dict->capacity) {
+				free_idx = 0;
+			}
+			if (free_idx == h) {
+				return NULL;
+			}
+		}
+		for (int j = free_idx; j != h; ) {
+			int prev = j == 0 ? dict->capacity - 1 : j - 1;
+			dict->entries[j] = dict->entries[prev];
+			j = prev;
+		}
+		memset(&dict->entries[h], 0, sizeof(struct dict_entry));
+	}
 	return &(dict->entries[h]);
 }
 
+static struct dict_entry* _dict_locate_or_reserve(struct dict* dict, void *key) {
+	return _dict_locate_or_reserve_hashed(dict, key, _dict_hash(dict, key));
+}
+
+/*
+ * Read-only counterpart of _dict_locate_or_reserve: return the ALLOCATED
+ * entry for key, or NULL if the key does not exist. The table is never
+ * changed. Entries still in an incremental rehash source are not searched;
+ * use dict_find for that.
+ */
+static struct dict_entry* _dict_locate(struct dict* dict, void *key) {
+	return _dict_lookup_hashed(dict, key, _dict_hash(dict, key));
+}
+
+/*
+ * Mark a FREE entry returned by _dict_locate_or_reserve as ALLOCATED.
+ */
+static void _dict_occupy(struct dict* dict, struct dict_entry* entry, uint32_t hash) {
+	assert(entry->flags == FREE);
+	entry->flags = ALLOCATED;
+	entry->hash = hash;
+	if (dict->layout == DICT_SWISS) {
+		int idx = entry - dict->entries;
+		if (dict->ctrl[idx] == DICT_CTRL_DELETED) {
+			--dict->ndeleted;
+		}
+		_dict_set_ctrl(dict, idx, hash & 0x7F);
+	}
+}
+
+/*
+ * Whether the next insertion should expand the dict first.
+ */
+static bool _dict_should_expand(struct dict* dict) {
+	return (int64_t) (dict->size + dict->ndeleted) * 100 >= (int64_t) dict->capacity * dict->max_load_pct;
+}
+
+/*
+ * Remove an ALLOCATED entry from the table without freeing its key/val.
+ *
+ * For DICT_LINEAR the following entries of the same cluster that are not at
+ * their home slot are shifted forward by one (backward-shift deletion), so no
+ * tombstone is needed. For DICT_SWISS the tag is set to DELETED. For
+ * DICT_COMPACT the entry becomes a hole and its index slot is removed with
+ * backward-shift deletion.
+ */
+static void _dict_erase(struct dict* dict, struct dict_entry* entry) {
+	assert(entry->flags == ALLOCATED);
+	int i = entry - dict->entries;
+	if (dict->layout == DICT_COMPACT) {
+		uint32_t mask = dict->capacity - 1;
+		uint32_t hole = entry->hash & mask;
+		while (dict->index[hole] != i) {
+			hole = (hole + 1) & mask;
+		}
+		// move back every later slot of the cluster whose home is not in
+		// (hole, pos]
+		for (uint32_t pos = (hole + 1) & mask; dict->index[pos] != DICT_INDEX_EMPTY; pos = (pos + 1) & mask) {
+			uint32_t home = dict->entries[dict->index[pos]].hash & mask;
+			if (((pos - home) & mask) >= ((pos - hole) & mask)) {
+				dict->index[hole] = dict->index[pos];
+				hole = pos;
+			}
+		}
+		dict->index[hole] = DICT_INDEX_EMPTY;
+		++dict->ndeleted;
+	} else if (dict->layout == DICT_SWISS) {
+		_dict_set_ctrl(dict, i, DICT_CTRL_DELETED);
+		++dict->ndeleted;
+	} else {
+		while (1) {
+			int j = i + 1 == dict->capacity ? 0 : i + 1;
+			if (dict->entries[j].flags == FREE || _dict_probe_dist(dict, j) == 0) {
+				break;
+			}
+			dict->entries[i] = dict->entries[j];
+			i = j;
+		}
+	}
+	memset(&dict->entries[i], 0, sizeof(struct dict_entry));
+	--dict->size;
+}
+
+/*
+ * Move an ALLOCATED entry from another table into dict. The key must not exist
+ * in dict yet.
+ */
+static void _dict_move_in(struct dict* dict, struct dict_entry* src_entry) {
+	struct dict_entry* dst_entry = _dict_locate_or_reserve_hashed(dict, src_entry->key, src_entry->hash);
+	assert(dst_entry && dst_entry->flags == FREE);
+	dst_entry->key = src_entry->key;
+	dst_entry->val = src_entry->val;
+	_dict_occupy(dict, dst_entry, src_entry->hash);
+}
+
+/*
+ * Migrate up to 'nslot' slots of the old table during an incremental rehash.
+ * Free the old table once all its slots are migrated.
+ */
+static void _dict_rehash_step(struct dict* dict, int nslot) {
+	struct dict* src = dict->rehash_src;
+	assert(src);
+	for (; nslot > 0 && dict->rehash_idx < src->capacity; --nslot) {
+		struct dict_entry* entry = &src->entries[dict->rehash_idx];
+		if (entry->flags == ALLOCATED) {
+			_dict_move_in(dict, entry);
+			// erasing may shift a later entry into this slot, so only advance
+			// rehash_idx once the slot is free.
+			_dict_erase(src, entry);
+		} else {
+			++dict->rehash_idx;
+		}
+	}
+	if (dict->rehash_idx == src->capacity) {
+		assert(src->size == 0);
+		alloc_free(dict->alloc, src->entries);
+		alloc_free(dict->alloc, src->ctrl);
+		alloc_free(dict->alloc, src);
+		dict->rehash_src = NULL;
+		dict->rehash_idx = 0;
+	}
+}
+
+static void _dict_rehash_finish(struct dict* dict) {
+	// a step over an ALLOCATED slot does not advance rehash_idx, so one
+	// capacity worth of steps may not be enough
+	while (dict->rehash_src) {
+		_dict_rehash_step(dict, dict->rehash_src->capacity);
+	}
+}
+
 /*
  * Return the dict_entry if key is found; Return NULL otherwise.
  */
 static struct dict_entry* dict_find(struct dict* dict, void *key) {
-	struct dict_entry* entry = _dict_locate(dict, key);
-	if (entry && entry->flags == ALLOCATED) {
-		assert(dict->eq_fn(key, entry->key));
-		return entry;
+	if (dict->rehash_src) {
+		_dict_rehash_step(dict, DICT_REHASH_STEP);
+	}
+	uint32_t hash = _dict_hash(dict, key);
+	struct dict_entry* entry = _dict_lookup_hashed(dict, key, hash);
+	if (!entry && dict->rehash_src) {
+		entry = _dict_lookup_hashed(dict->rehash_src, key, hash);
+	}
+	assert(!entry || dict->eq_fn(key, entry->key));
+	_DICT_STAT(++dict->stats.nfind; ++*(entry ? &dict->stats.nhit : &dict->stats.nmiss));
+	return entry;
+}
+
+static bool _dict_strview_eq_fn(void* _view, void* _key) {
+	return strview_eq_cstr(*(struct strview*) _view, (const char*) _key);
+}
+
+/*
+ * dict_find for a dict keyed by C strings (str_hash_fn or str_hash_seeded_fn
+ * with str_eq_fn), with the key given as a view. The view is hashed with its
+ * known length and compared in place, so it needs no '\0' and is not copied.
+ *
+ * Unlike dict_find, this does not advance a pending incremental rehash: the
+ * dict is not modified, so it can be called by concurrent readers.
+ */
+static struct dict_entry* dict_find_view(struct dict* dict, struct strview view) {
+	assert(dict->eq_fn == str_eq_fn);
+	uint32_t hash;
+	if (dict->seeded_hash_fn) {
+		assert(dict->seeded_hash_fn == str_hash_seeded_fn);
+		hash = strview_hash_seeded(view, dict->seed);
 	} else {
-		return NULL;
+		assert(dict->hash_fn == str_hash_fn);
+		hash = strview_hash(view);
+	}
+	struct dict_entry* entry = _dict_lookup_hashed_eq(dict, &view, hash, _dict_strview_eq_fn);
+	if (!entry && dict->rehash_src) {
+		entry = _dict_lookup_hashed_eq(dict->rehash_src, &view, hash, _dict_strview_eq_fn);
+	}
+	_DICT_STAT(++dict->stats.nfind; ++*(entry ? &dict->stats.nhit : &dict->stats.nmiss));
+	return entry;
+}
+
+/*
+ * Home entry of hash for the prefetching in dict_find_batch. For
+ * DICT_COMPACT this reads the index slot, so it's only called once the slot
+ * has been prefetched. Return NULL if there is none.
+ */
+static inline struct dict_entry* _dict_home_entry(struct dict* dict, uint32_t hash) {
+	uint32_t mask = dict->capacity - 1;
+	if (dict->layout == DICT_SWISS) {
+		return &dict->entries[(hash >> 7) & mask];
+	}
+	if (dict->layout == DICT_COMPACT) {
+		int32_t idx = dict->index[hash & mask];
+		return idx == DICT_INDEX_EMPTY ? NULL : &dict->entries[idx];
+	}
+	return &dict->entries[hash % dict->capacity];
+}
+
+/*
+ * Look up n keys and store the entry (or NULL) of keys[i] to out[i].
+ *
+ * Same result as calling dict_find for each key, but the keys are processed
+ * in groups of DICT_BATCH_SIZE: hash the whole group and prefetch the home
+ * slots, then prefetch the keys of the home entries whose hash matches, and
+ * only then probe. The keys of the next group are prefetched ahead of
+ * hashing too. So the cache misses of a group overlap instead of being paid
+ * one key after another.
+ *
+ * A pending incremental rehash is finished first.
+ */
+static void dict_find_batch(struct dict* dict, void **keys, int n, struct dict_entry **out) {
+	// finish a pending incremental rehash first. Otherwise a later lookup in
+	// the batch could move an entry already returned in out.
+	_dict_rehash_finish(dict);
+	uint32_t hashes[DICT_BATCH_SIZE];
+	for (int base = 0; base < n; base += DICT_BATCH_SIZE) {
+		int cnt = n - base < DICT_BATCH_SIZE ? n - base : DICT_BATCH_SIZE;
+		uint32_t mask = dict->capacity - 1;
+		for (int i = base + DICT_BATCH_SIZE; i < n && i < base + 2 * DICT_BATCH_SIZE; ++i) {
+			// hashing the next group reads its keys
+			__builtin_prefetch(keys[i]);
+		}
+		for (int i = 0; i < cnt; ++i) {
+			uint32_t hash = hashes[i] = _dict_hash(dict, keys[base + i]);
+			if (dict->layout == DICT_SWISS) {
+				__builtin_prefetch(dict->ctrl + ((hash >> 7) & mask));
+				__builtin_prefetch(&dict->entries[(hash >> 7) & mask]);
+			} else if (dict->layout == DICT_COMPACT) {
+				__builtin_prefetch(&dict->index[hash & mask]);
+			} else {
+				__builtin_prefetch(&dict->entries[hash % dict->capacity]);
+			}
+		}
+		if (dict->layout == DICT_COMPACT) {
+			for (int i = 0; i < cnt; ++i) {
+				struct dict_entry* entry = _dict_home_entry(dict, hashes[i]);
+				if (entry) {
+					__builtin_prefetch(entry);
+				}
+			}
+		}
+		for (int i = 0; i < cnt; ++i) {
+			struct dict_entry* entry = _dict_home_entry(dict, hashes[i]);
+			if (entry && entry->hash == hashes[i]) {
+				// a likely hit. eq_fn will read the stored key.
+				__builtin_prefetch(entry->key);
+			}
+		}
+		for (int i = 0; i < cnt; ++i) {
+			out[base + i] = _dict_lookup_hashed(dict, keys[base + i], hashes[i]);
+			_DICT_STAT(++dict->stats.nfind; ++*(out[base + i] ? &dict->stats.nhit : &dict->stats.nmiss));
+		}
 	}
 }
 
@@ -150,80 +856,231 @@ static void *dict_find_nomiss(struct dict* dict, void *key) {
 	return entry->val;
 }
 
-static void _dict_expand(struct dict* dict) {
-  struct dict_entry* oldentries = dict->entries;
-	int oldcapacity = dict->capacity;
-  int newcapacity = (dict->capacity << 1);
-  struct dict_entry* newentries = (struct dict_entry*) calloc(newcapacity, sizeof(struct dict_entry));
+/*
+ * Move all entries to a new table with 'newcapacity' slots. If incremental is
+ * set, only allocate the new table and let later operations migrate the
+ * entries.
+ */
+static void _dict_rehash_to(struct dict* dict, int newcapacity, bool incremental) {
+	// at most one incremental rehash at a time
+	_dict_rehash_finish(dict);
+	assert((int64_t) dict->size * 100 < (int64_t) newcapacity * dict->max_load_pct);
+
+	struct dict old = *dict;
+	dict->ndeleted = 0;
 
-	// set capacity and entries before calling _dict_locate since _dict_locate
-	// need access these fields.
+	// set capacity and entries before calling _dict_locate_or_reserve since
+	// _dict_locate_or_reserve need access these fields.
   dict->capacity = newcapacity;
-  dict->entries = newentries;
+	_DICT_STAT(if (newcapacity > dict->stats.peak_capacity) dict->stats.peak_capacity = newcapacity);
+  dict->entries = (struct dict_entry*) alloc_calloc(dict->alloc, _dict_entries_capacity(dict->layout, newcapacity, dict->max_load_pct), sizeof(struct dict_entry));
+	if (dict->layout == DICT_SWISS) {
+		dict->ctrl = _dict_alloc_ctrl(dict->alloc, newcapacity);
+	}
+
+	if (dict->layout == DICT_COMPACT) {
+		// squeeze out the holes keeping the insertion order
+		dict->index = _dict_alloc_index(dict->alloc, newcapacity);
+		uint32_t mask = newcapacity - 1;
+		int n = 0;
+		for (int i = 0; i < _dict_nentry(&old); ++i) {
+			if (old.entries[i].flags == ALLOCATED) {
+				uint32_t pos = old.entries[i].hash & mask;
+				while (dict->index[pos] != DICT_INDEX_EMPTY) {
+					pos = (pos + 1) & mask;
+				}
+				dict->index[pos] = n;
+				dict->entries[n++] = old.entries[i];
+			}
+		}
+		assert(n == dict->size);
+		alloc_free(dict->alloc, old.entries);
+		alloc_free(dict->alloc, old.index);
+		return;
+	}
+
+	if (incremental) {
+		dict->rehash_src = (struct dict*) alloc_malloc(dict->alloc, sizeof(struct dict));
+		*dict->rehash_src = old;
+		dict->rehash_idx = 0;
+		return;
+	}
 
-  for (int i = 0; i < oldcapacity; ++i) {
-    struct dict_entry* src_entry = oldentries + i;
+  for (int i = 0; i < old.capacity; ++i) {
+    struct dict_entry* src_entry = old.entries + i;
     if (src_entry->flags == ALLOCATED) {
-      struct dict_entry* dst_entry = _dict_locate(dict, src_entry->key);
-      dst_entry->key = src_entry->key;
-      dst_entry->val = src_entry->val;
-			dst_entry->flags = ALLOCATED;
+			_dict_move_in(dict, src_entry);
     }
   }
 
-  free(oldentries);
+  alloc_free(dict->alloc, old.entries);
+	alloc_free(dict->alloc, old.ctrl);
+}
+
+static void _dict_expand(struct dict* dict) {
+#ifdef DICT_STATS
+	uint64_t start = _dict_stats_now_ns();
+#endif
+  int newcapacity = (dict->capacity << 1);
+	if ((int64_t) dict->size * 200 < (int64_t) dict->capacity * dict->max_load_pct) {
+		// mostly DELETED tags. Rehash at the same capacity to drop them.
+		newcapacity = dict->capacity;
+	}
+	_dict_rehash_to(dict, newcapacity, dict->incremental_rehash && dict->layout != DICT_COMPACT);
+	_DICT_STAT(++dict->stats.nexpand; dict->stats.expand_ns += _dict_stats_now_ns() - start);
 }
 
 /*
- * Insert if the key is not added yet; update if the key already exits.
- * Return the number of entries created.
+ * Make sure n entries in total fit without growing the table again.
  */
-static int dict_put(struct dict* dict, void *key, void *val) {
-	// at most 50% full
-	if ((dict->size << 1) >= dict->capacity) {
-		_dict_expand(dict);
+static void dict_reserve(struct dict* dict, int n) {
+	assert(n >= 0);
+	int capacity = _dict_capacity_for(n, dict->max_load_pct);
+	if (capacity > dict->capacity) {
+		_dict_rehash_to(dict, capacity, false);
+	}
+}
+
+/*
+ * Set the maximum load of the table in percent. A lower load means more memory
+ * and shorter probes. Grow the table right away if it is over the new limit.
+ */
+static void dict_set_max_load_pct(struct dict* dict, int max_load_pct) {
+	// always keep free slots around so a miss terminates
+	assert(max_load_pct >= 10 && max_load_pct <= 95);
+	dict->max_load_pct = max_load_pct;
+	if (dict->layout == DICT_COMPACT) {
+		// the entries array is sized for the load limit
+		int capacity = _dict_capacity_for(dict->size, max_load_pct);
+		_dict_rehash_to(dict, capacity > dict->capacity ? capacity : dict->capacity, false);
+	} else if (_dict_should_expand(dict)) {
+		dict_reserve(dict, dict->size + 1);
 	}
-	struct dict_entry* entry = _dict_locate(dict, key);
+}
+
+/*
+ * Replace the key/val of an ALLOCATED entry.
+ */
+static void _dict_update(struct dict* dict, struct dict_entry* entry, void *key, void *val) {
+	if (dict->should_free_key) {
+		alloc_free(dict->alloc, entry->key);
+	}
+	if (dict->should_free_val) {
+		alloc_free(dict->alloc, entry->val);
+	}
+	entry->key = key;
+	entry->val = val;
+}
+
+/*
+ * Insert or update without checking whether the table should grow.
+ * Return the number of entries created.
+ */
+static int _dict_insert_hashed(struct dict* dict, void *key, void *val, uint32_t hash) {
+	struct dict_entry* entry = _dict_locate_or_reserve_hashed(dict, key, hash);
 	assert(entry);
 	if (entry->flags == ALLOCATED) {
 		// update
-		if (dict->should_free_key) {
-			free(entry->key);
-		}
-		if (dict->should_free_val) {
-			free(entry->val);
-		}
-		entry->key = key;
-		entry->val = val;
+		_dict_update(dict, entry, key, val);
 		return 0;
 	} else {
 		// insert
-		assert(entry->flags == FREE);
 		entry->key = key;
 		entry->val = val;
-		entry->flags = ALLOCATED;
+		_dict_occupy(dict, entry, hash);
 		++dict->size;
 		return 1;
 	}
 }
 
+/*
+ * Insert if the key is not added yet; update if the key already exits.
+ * Return the number of entries created.
+ */
+static int dict_put(struct dict* dict, void *key, void *val) {
+	if (dict->rehash_src) {
+		_dict_rehash_step(dict, DICT_REHASH_STEP);
+	}
+	if (_dict_should_expand(dict)) {
+		_dict_expand(dict);
+	}
+	uint32_t hash = _dict_hash(dict, key);
+	if (dict->rehash_src) {
+		struct dict_entry* entry = _dict_lookup_hashed(dict->rehash_src, key, hash);
+		if (entry) {
+			_dict_update(dict, entry, key, val);
+			return 0;
+		}
+	}
+	return _dict_insert_hashed(dict, key, val, hash);
+}
+
+/*
+ * Build a DICT_LINEAR dict from n keys and values (vals can be NULL for all
+ * NULL values). The table is sized once up front. For duplicated keys the
+ * last one wins just like calling dict_put in order.
+ */
+static struct dict dict_build_from_arrays(hash_fn_t hash_fn, eq_fn_t eq_fn, bool should_free_key, bool should_free_val, void **keys, void **vals, int n) {
+	struct dict dict = dict_create_with_capacity(hash_fn, eq_fn, should_free_key, should_free_val, n);
+	for (int i = 0; i < n; ++i) {
+		_dict_insert_hashed(&dict, keys[i], vals ? vals[i] : NULL, _dict_hash(&dict, keys[i]));
+	}
+	return dict;
+}
+
+/*
+ * Remove the key if it exists. Free the key/val stored in the dict if the
+ * dict is configured to do so.
+ * Return the number of entries removed.
+ */
+static int dict_remove(struct dict* dict, void *key) {
+	if (dict->rehash_src) {
+		_dict_rehash_step(dict, DICT_REHASH_STEP);
+	}
+	uint32_t hash = _dict_hash(dict, key);
+	struct dict* table = dict;
+	struct dict_entry* entry = _dict_lookup_hashed(dict, key, hash);
+	if (!entry && dict->rehash_src) {
+		table = dict->rehash_src;
+		entry = _dict_lookup_hashed(table, key, hash);
+	}
+	if (!entry) {
+		return 0;
+	}
+	if (dict->should_free_key) {
+		alloc_free(dict->alloc, entry->key);
+	}
+	if (dict->should_free_val) {
+		alloc_free(dict->alloc, entry->val);
+	}
+	_dict_erase(table, entry);
+	if (table != dict) {
+		// 'size' of the main dict covers both tables
+		--dict->size;
+	}
+	return 1;
+}
+
 static void dict_free(struct dict* dict) {
-  for (int i = 0; i < dict->capacity; ++i) {
+	_dict_rehash_finish(dict);
+  for (int i = 0; i < _dict_nentry(dict); ++i) {
 		struct dict_entry* entry = &dict->entries[i];
 		if (entry->flags == ALLOCATED) {
 			if (dict->should_free_key) {
-				free(entry->key);
+				alloc_free(dict->alloc, entry->key);
 			}
 			if (dict->should_free_val) {
-				free(entry->val);
+				alloc_free(dict->alloc, entry->val);
 			}
 		}
   }
-  free(dict->entries);
+  alloc_free(dict->alloc, dict->entries);
+	alloc_free(dict->alloc, dict->ctrl);
+	alloc_free(dict->alloc, dict->index);
 }
 
 static struct dict_entry *dict_end(struct dict *dict) {
-  return dict->entries + dict->capacity;
+  return dict->entries + _dict_nentry(dict);
 }
 
 /*
@@ -244,7 +1101,56 @@ static struct dict_entry *dict_next(struct dict *dict, struct dict_entry *cur) {
 /*
  * If the dict is not empty, return the pointer to the first entry, otherwise
  * return end.
+ *
+ * A pending incremental rehash is finished first so all entries are in one
+ * table while iterating.
  */
 static struct dict_entry *dict_begin(struct dict *dict) {
+	_dict_rehash_finish(dict);
   return _dict_skip_unused(dict, dict->entries);
 }
+
+/*
+ * Return the counters collected so far. All zeros unless built with
+ * DICT_STATS.
+ */
+static struct dict_stats dict_stats_get(struct dict *dict) {
+	struct dict_stats stats;
+#ifdef DICT_STATS
+	stats = dict->stats;
+#else
+	memset(&stats, 0, sizeof(stats));
+#endif
+	return stats;
+}
+
+static void dict_stats_reset(struct dict *dict) {
+#ifdef DICT_STATS
+	memset(&dict->stats, 0, sizeof(dict->stats));
+	dict->stats.peak_capacity = dict->capacity;
+#endif
+}
+
+static void dict_stats_dump(struct dict *dict, FILE *fp) {
+#ifndef DICT_STATS
+	fprintf(fp, "dict stats: not built with DICT_STATS\n");
+#else
+	struct dict_stats *stats = &dict->stats;
+	fprintf(fp, "dict stats: size %d, capacity %d, peak capacity %d\n", dict->size, dict->capacity, stats->peak_capacity);
+	fprintf(fp, "  find %llu (hit %llu, miss %llu), eq_fn calls %llu\n",
+		(unsigned long long) stats->nfind, (unsigned long long) stats->nhit,
+		(unsigned long long) stats->nmiss, (unsigned long long) stats->neq);
+	fprintf(fp, "  expand %llu, %.3f ms\n", (unsigned long long) stats->nexpand, stats->expand_ns / 1e6);
+	uint64_t nprobe = 0;
+	for (int i = 0; i < DICT_PROBE_HIST_SIZE; ++i) {
+		nprobe += stats->probe_hist[i];
+	}
+	fprintf(fp, "  probe length histogram (%s):\n", dict->layout == DICT_SWISS ? "groups" : "slots");
+	for (int i = 0; i < DICT_PROBE_HIST_SIZE; ++i) {
+		if (stats->probe_hist[i]) {
+			fprintf(fp, "    %s%2d: %llu (%.2f%%)\n", i == DICT_PROBE_HIST_SIZE - 1 ? ">=" : "  ", i,
+				(unsigned long long) stats->probe_hist[i], 100.0 * stats->probe_hist[i] / nprobe);
+		}
+	}
+#endif
+}
@@ -0,0 +1,214 @@
+#pragma once
+
+/*
+ * DICT_DEFINE(name, K, V, hash, eq) generates a dictionary specialized for
+ * key type K and value type V:
+ *
+ *   struct name;                   // the dict
+ *   struct name##_entry;           // {K key; V val; ...}
+ *   struct name name##_create();
+ *   struct name##_entry *name##_find(struct name *, K key);
+ *   int name##_put(struct name *, K key, V val);
+ *   int name##_remove(struct name *, K key);
+ *   void name##_free(struct name *);
+ *   name##_begin / name##_next / name##_end for iteration
+ *
+ * 'hash' is a function or macro taking a K and returning uint32_t, 'eq' takes
+ * two K and returns a truth value. Both are called directly so the compiler can
+ * inline them.
+ *
+ * Compared with struct dict:
+ * - keys and values are stored inline in the slot array, so a V bigger than a
+ *   pointer does not need its own heap allocation.
+ * - the dict never frees keys or values. Keys that are pointers (e.g. char*)
+ *   must outlive the dict.
+ * - the probing scheme is the same as DICT_LINEAR: Robin Hood linear probing
+ *   with the hash cached in each entry and backward-shift deletion. The
+ *   capacity is a power of 2 and the table is at most 50% full.
+ *
+ * Example:
+ *   DICT_DEFINE(str_int_dict, const char*, int, dict_cstr_hash, dict_cstr_eq)
+ *   struct str_int_dict d = str_int_dict_create();
+ *   str_int_dict_put(&d, "hello", 2);
+ *   assert(str_int_dict_find(&d, "hello")->val == 2);
+ *   str_int_dict_free(&d);
+ */
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <assert.h>
+#include "scom/util.h"
+#include "scom/hash.h"
+
+#define DICT_DEFINE_FOREACH(name, dict_ptr, entry_ptr) \
+  for (struct name##_entry *entry_ptr = name##_begin(dict_ptr); \
+      entry_ptr != name##_end(dict_ptr); \
+      entry_ptr = name##_next(dict_ptr, entry_ptr))
+
+static inline uint32_t dict_int_hash(int64_t key) {
+	return _hash_fold32(_hash_mum((uint64_t) key ^ _HASH_S0, _HASH_S1));
+}
+
+static inline bool dict_int_eq(int64_t lhs, int64_t rhs) {
+	return lhs == rhs;
+}
+
+static inline uint32_t dict_cstr_hash(const char *key) {
+	return _hash_fold32(hash_bytes(key, strlen(key), 0));
+}
+
+static inline bool dict_cstr_eq(const char *lhs, const char *rhs) {
+	return strcmp(lhs, rhs) == 0;
+}
+
+#define DICT_DEFINE(name, K, V, hash, eq) \
+struct name##_entry { \
+	K key; \
+	V val; \
+	uint32_t hash; \
+	bool used; \
+}; \
+\
+struct name { \
+	struct name##_entry *entries; \
+	int size; \
+	int capacity; \
+}; \
+\
+static inline struct name name##_create() { \
+	struct name dict; \
+	dict.size = 0; \
+	dict.capacity = 64; \
+	dict.entries = (struct name##_entry*) calloc(dict.capacity, sizeof(struct name##_entry)); \
+	return dict; \
+} \
+\
+static inline int name##_probe_dist(struct name *dict, int idx) { \
+	return (idx - (int) dict->entries[idx].hash) & (dict->capacity - 1); \
+} \
+\
+/* \
+ * Lookup with the hash of 'key' already computed, so callers that also \
+ * insert hash only once. \
+ */ \
+static inline struct name##_entry *_##name##_find_hashed(struct name *dict, K key, uint32_t h) { \
+	int mask = dict->capacity - 1; \
+	for (int idx = h & mask, dist = 0; ; idx = (idx + 1) & mask, ++dist) { \
+		struct name##_entry *entry = &dict->entries[idx]; \
+		if (!entry->used || name##_probe_dist(dict, idx) < dist) { \
+			return NULL; \
+		} \
+		if (entry->hash == h && eq(entry->key, key)) { \
+			return entry; \
+		} \
+	} \
+} \
+\
+static inline struct name##_entry *name##_find(struct name *dict, K key) { \
+	return _##name##_find_hashed(dict, key, hash(key)); \
+} \
+\
+/* \
+ * Insert an entry known to be absent. Robin Hood: swap with any entry that is \
+ * closer to its home slot and carry that one forward. \
+ */ \
+static inline void _##name##_insert_new(struct name *dict, struct name##_entry cur) { \
+	int mask = dict->capacity - 1; \
+	int idx = cur.hash & mask; \
+	for (int dist = 0; ; idx = (idx + 1) & mask, ++dist) { \
+		struct name##_entry *entry = &dict->entries[idx]; \
+		if (!entry->used) { \
+			*entry = cur; \
+			return; \
+		} \
+		int entry_dist = name##_probe_dist(dict, idx); \
+		if (entry_dist < dist) { \
+			struct name##_entry tmp = *entry; \
+			*entry = cur; \
+			cur = tmp; \
+			dist = entry_dist; \
+		} \
+	} \
+} \
+\
+static inline void _##name##_expand(struct name *dict) { \
+	struct name##_entry *old = dict->entries; \
+	int oldcapacity = dict->capacity; \
+	dict->capacity <<= 1; \
+	dict->entries = (struct name##_entry*) calloc(dict->capacity, sizeof(struct name##_entry)); \
+	for (int i = 0; i < oldcapacity; ++i) { \
+		if (old[i].used) { \
+			_##name##_insert_new(dict, old[i]); \
+		} \
+	} \
+	free(old); \
+} \
+\
+/* \
+ * Insert if the key is not added yet; update if the key already exits. \
+ * Return the number of entries created. \
+ */ \
+static inline int name##_put(struct name *dict, K key, V val) { \
+	uint32_t h = hash(key); \
+	struct name##_entry *entry = _##name##_find_hashed(dict, key, h); \
+	if (entry) { \
+		entry->val = val; \
+		return 0; \
+	} \
+	if ((dict->size << 1) >= dict->capacity) { \
+		_##name##_expand(dict); \
+	} \
+	struct name##_entry cur; \
+	cur.key = key; \
+	cur.val = val; \
+	cur.hash = h; \
+	cur.used = true; \
+	_##name##_insert_new(dict, cur); \
+	++dict->size; \
+	return 1; \
+} \
+\
+/* \
+ * Return the number of entries removed. \
+ */ \
+static inline int name##_remove(struct name *dict, K key) { \
+	struct name##_entry *entry = name##_find(dict, key); \
+	if (!entry) { \
+		return 0; \
+	} \
+	int mask = dict->capacity - 1; \
+	int idx = entry - dict->entries; \
+	for (int next = (idx + 1) & mask; \
+			dict->entries[next].used && name##_probe_dist(dict, next) > 0; \
+			idx = next, next = (next + 1) & mask) { \
+		dict->entries[idx] = dict->entries[next]; \
+	} \
+	memset(&dict->entries[idx], 0, sizeof(struct name##_entry)); \
+	--dict->size; \
+	return 1; \
+} \
+\
+static inline void name##_free(struct name *dict) { \
+	free(dict->entries); \
+	dict->entries = NULL; \
+} \
+\
+static inline struct name##_entry *name##_end(struct name *dict) { \
+	return dict->entries + dict->capacity; \
+} \
+\
+static inline struct name##_entry *_##name##_skip_unused(struct name *dict, struct name##_entry *cur) { \
+	while (cur != name##_end(dict) && !cur->used) { \
+		++cur; \
+	} \
+	return cur; \
+} \
+\
+static inline struct name##_entry *name##_next(struct name *dict, struct name##_entry *cur) { \
+	return _##name##_skip_unused(dict, cur + 1); \
+} \
+\
+static inline struct name##_entry *name##_begin(struct name *dict) { \
+	return _##name##_skip_unused(dict, dict->entries); \
+}
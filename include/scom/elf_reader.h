@@ -2,11 +2,16 @@
 
 #include <assert.h>
 #include <stdlib.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
 #include <sys/stat.h>
+#include <sys/mman.h>
 #include "scom/util.h"
 #include "scom/elf.h"
 #include "scom/dict.h"
 #include "scom/vec.h"
+#include "scom/strview.h"
 #include "scom/check.h"
 
 struct elf_reader {
@@ -16,6 +21,9 @@ struct elf_reader {
 	// whether this elf_reader owns buf. If yes, the destructor should free the
 	// buffer.
 	bool own_buf;
+	// whether buf is a mapping of the file created by elfr_create_mmap. If yes,
+	// the destructor should munmap it.
+	bool mapped;
 	int file_size; // file or buf size in bytes
   Elf32_Ehdr* ehdr; // point to the beginning of buf
 
@@ -28,6 +36,10 @@ struct elf_reader {
   Elf32_Sym* symtab; // content of the main symtab section. Usually named '.symtab'.
   int symtab_size;
   char *symstr; // content of the string table for .symtab. Usually named '.strtab'
+  int symstr_size;
+  // name of each symbol in symtab. NULL until elfr_build_symnames; read-only
+  // afterwards, so it can be shared across threads.
+  struct strview *symnames;
 
 	/*
 	 * Map a section name to the absolute address the section gonna
@@ -203,7 +215,8 @@ static struct elf_reader elfr_create_from_buffer(const char* buf, int size, bool
   reader.sh_shstrtab = elfr_get_shdr(&reader, reader.ehdr->e_shstrndx);
 	reader.shstrtab = elfr_load_range(&reader, reader.sh_shstrtab->sh_offset, reader.sh_shstrtab->sh_size);
 
-	reader.section_name_to_abs_addr = dict_create_str_int();
+	// at most one entry per section
+	reader.section_name_to_abs_addr = dict_create_with_capacity(str_hash_fn, str_eq_fn, 1, 0, reader.shtab_size);
 
 	for (int i = 0; i < reader.shtab_size; ++i) {
     Elf32_Shdr* shdr = elfr_get_shdr(&reader, i);
@@ -217,6 +230,7 @@ static struct elf_reader elfr_create_from_buffer(const char* buf, int size, bool
       shdr_link = elfr_get_shdr(&reader, shdr->sh_link);
       assert(shdr_link->sh_type == SHT_STRTAB);
       reader.symstr = elfr_load_range(&reader, shdr_link->sh_offset, shdr_link->sh_size);
+      reader.symstr_size = shdr_link->sh_size;
       break;
     default:
       break;
@@ -258,12 +272,63 @@ static struct elf_reader elfr_create(const char* path) {
   return elfr_create_from_buffer(buf, file_size, true);
 }
 
+/*
+ * Pass the advice for the bytes [start, start + size) of the mapping, widened
+ * to whole pages.
+ */
+static void _elfr_madvise(void *start, int size, int advice) {
+	if (!start || size <= 0) {
+		return;
+	}
+	uintptr_t page = sysconf(_SC_PAGESIZE);
+	uintptr_t lo = (uintptr_t) start & ~(page - 1);
+	uintptr_t hi = (uintptr_t) start + size;
+	// only a hint, ignore failures
+	(void) madvise((void*) lo, hi - lo, advice);
+}
+
+/*
+ * Like elfr_create, but map the file instead of reading it into the heap, so
+ * only the pages the reader touches are ever loaded. Every pointer in the
+ * reader points into the mapping.
+ *
+ * The mapping is read-only unless 'writable' is set, in which case it is a
+ * private copy-on-write mapping: relocations can be applied in place and only
+ * the modified pages are copied, the file is never changed.
+ */
+static struct elf_reader elfr_create_mmap(const char* path, bool writable) {
+	int fd = open(path, O_RDONLY);
+	CHECK(fd >= 0, "fail to open %s: %s", path, strerror(errno));
+	struct stat elf_st;
+	CHECK(fstat(fd, &elf_st) == 0, "fail to stat %s: %s", path, strerror(errno));
+	CHECK(elf_st.st_size > 0, "empty file %s", path);
+	int file_size = elf_st.st_size;
+	void *buf = mmap(NULL, file_size, writable ? PROT_READ | PROT_WRITE : PROT_READ,
+		writable ? MAP_PRIVATE : MAP_SHARED, fd, 0);
+	CHECK(buf != MAP_FAILED, "fail to mmap %s: %s", path, strerror(errno));
+	// the mapping stays valid after the fd is closed
+	close(fd);
+
+	struct elf_reader reader = elfr_create_from_buffer(buf, file_size, false);
+	reader.mapped = true;
+	// symbols are scanned front to back. Start reading the symtab and its
+	// strings ahead instead of taking one fault per page.
+	_elfr_madvise(reader.symtab, reader.symtab_size * sizeof(Elf32_Sym), MADV_SEQUENTIAL);
+	_elfr_madvise(reader.symtab, reader.symtab_size * sizeof(Elf32_Sym), MADV_WILLNEED);
+	_elfr_madvise(reader.symstr, reader.symstr_size, MADV_WILLNEED);
+	return reader;
+}
+
 static void elfr_free(struct elf_reader* reader) {
 	assert(reader->buf);
-	if (reader->own_buf) {
+	if (reader->mapped) {
+		munmap(reader->buf, reader->file_size);
+	} else if (reader->own_buf) {
 		free(reader->buf);
 	}
 	reader->buf = NULL;
+	free(reader->symnames);
+	reader->symnames = NULL;
 	dict_free(&reader->section_name_to_abs_addr);
 }
 
@@ -303,25 +368,101 @@ static int elfr_is_defined_section(struct elf_reader* reader, int secno) {
   return (secno > 0 && secno < reader->shtab_size) || secno == SHN_ABS;
 }
 
+/*
+ * Take the length of every symbol name in one pass so elfr_get_symname no
+ * longer needs a strlen. Readers that never ask for views don't pay for it.
+ * Call it before sharing the reader across threads; it does nothing if the
+ * names are already built.
+ */
+static void elfr_build_symnames(struct elf_reader* reader) {
+	if (reader->symnames || reader->symtab_size == 0) {
+		return;
+	}
+	reader->symnames = (struct strview*) malloc(sizeof(struct strview) * reader->symtab_size);
+	CHECK(reader->symnames, "fail to allocate %d symbol names", reader->symtab_size);
+	for (int i = 0; i < reader->symtab_size; ++i) {
+		reader->symnames[i] = strview_from_cstr(reader->symstr + reader->symtab[i].st_name);
+	}
+}
+
+/*
+ * Return the name of symbol 'idx' as a view into symstr. The length comes
+ * from elfr_build_symnames if it has been called, otherwise it is taken
+ * here. Never modifies the reader.
+ */
+static struct strview elfr_get_symname(const struct elf_reader* reader, int idx) {
+	assert(idx >= 0 && idx < reader->symtab_size);
+	if (reader->symnames) {
+		return reader->symnames[idx];
+	}
+	return strview_from_cstr(reader->symstr + reader->symtab[idx].st_name);
+}
+
+// matches are staged locally and appended a batch at a time
+#define ELFR_SYM_BATCH 64
+
+/*
+ * Scan the symtab from *pidx for global and weak symbols defined in this
+ * file. Store up to ELFR_SYM_BATCH of their indices to 'idxbuf' and whether
+ * each is weak to 'weakbuf', and advance *pidx past the scanned symbols.
+ * Return the number found; 0 once the symtab is done.
+ */
+static int _elfr_next_global_defined_batch(struct elf_reader *reader, int *pidx, int *idxbuf, bool *weakbuf) {
+	int n = 0;
+	for (; *pidx < reader->symtab_size && n < ELFR_SYM_BATCH; ++*pidx) {
+		Elf32_Sym* sym = reader->symtab + *pidx;
+		int bind = ELF32_ST_BIND(sym->st_info);
+		if ((bind == STB_GLOBAL || bind == STB_WEAK) && elfr_is_defined_section(reader, sym->st_shndx)) {
+			idxbuf[n] = *pidx;
+			weakbuf[n] = bind == STB_WEAK;
+			++n;
+		}
+	}
+	return n;
+}
+
 /*
  * Fill in 'names' and 'weaks' with global symbol name and if the symbol is weak.
  * If either vec* is NULL then the filling is skipped.
  */
 static void elfr_get_global_defined_syms2(struct elf_reader *reader, struct vec *names, struct vec *weaks) {
-	bool trueval = 1, falseval = 0;
-  for (int i = 0; i < reader->symtab_size; ++i) {
-    Elf32_Sym* sym = reader->symtab + i;
-    int bind = ELF32_ST_BIND(sym->st_info);
-    char* name = reader->symstr + sym->st_name;
-    if ((bind == STB_GLOBAL || bind == STB_WEAK) && elfr_is_defined_section(reader, sym->st_shndx)) {
-			if (names) {
-	      vec_append(names, &name);
-		  }
-			if (weaks) {
-				vec_append(weaks, bind == STB_GLOBAL ? &falseval : &trueval);
+	int idxbuf[ELFR_SYM_BATCH];
+	bool weakbuf[ELFR_SYM_BATCH];
+	char* namebuf[ELFR_SYM_BATCH];
+	int n;
+	for (int i = 0; (n = _elfr_next_global_defined_batch(reader, &i, idxbuf, weakbuf)) > 0; ) {
+		if (names) {
+			for (int j = 0; j < n; ++j) {
+				namebuf[j] = reader->symstr + reader->symtab[idxbuf[j]].st_name;
 			}
-    }
-  }
+			vec_extend(names, namebuf, n);
+		}
+		if (weaks) {
+			vec_extend(weaks, weakbuf, n);
+		}
+	}
+}
+
+/*
+ * Same as elfr_get_global_defined_syms2 but 'names' gets a struct strview
+ * per symbol, so the consumers do not need strlen on them.
+ */
+static void elfr_get_global_defined_sym_views(struct elf_reader *reader, struct vec *names, struct vec *weaks) {
+	int idxbuf[ELFR_SYM_BATCH];
+	bool weakbuf[ELFR_SYM_BATCH];
+	struct strview namebuf[ELFR_SYM_BATCH];
+	int n;
+	for (int i = 0; (n = _elfr_next_global_defined_batch(reader, &i, idxbuf, weakbuf)) > 0; ) {
+		if (names) {
+			for (int j = 0; j < n; ++j) {
+				namebuf[j] = elfr_get_symname(reader, idxbuf[j]);
+			}
+			vec_extend(names, namebuf, n);
+		}
+		if (weaks) {
+			vec_extend(weaks, weakbuf, n);
+		}
+	}
 }
 
 /*
@@ -1,6 +1,10 @@
 #pragma once
 
+#include <stdio.h>
+#include <unistd.h>
 #include "scom/str.h"
+#include "scom/chunkbuf.h"
+#include "scom/strtab.h"
 #include "scom/elf.h"
 #include "scom/vec.h"
 #include "scom/util.h"
@@ -12,17 +16,28 @@
 
 struct elf_writer {
 	Elf32_Ehdr ehdr;
-  struct str shstrtab; // contains section names
+  // section names. The offsets are only known once elfw_write finalizes it.
+  struct strtab shstrtab;
 
 	uint32_t next_file_off; // track the layout of the elf file
 	uint32_t next_va; // track the layout in memory when the elf file is loaded
 
 	struct vec phdrtab; // program header table
-	struct vec pbuftab; // program buffer table
+	struct vec pbuftab; // program buffer table. struct elfw_segbuf.
 
-	struct vec shdrtab; // section header table
+	struct vec shdrtab; // section header table. sh_name is filled in on output.
+	struct vec shdr_name_ids; // uint32_t. shstrtab ID of each section's name.
 };
 
+/*
+ * The content of a segment: a struct str, or a struct chunkbuf for segments
+ * too big to keep contiguous.
+ */
+struct elfw_segbuf {
+	bool chunked;
+	struct str str;
+	struct chunkbuf chunks;
+};
 
 static int elfw_add_shdr(struct elf_writer* writer, const char* name, uint32_t type, uint32_t flags, uint32_t link, uint32_t info, uint32_t addralign, uint32_t entsize);
 
@@ -61,11 +76,11 @@ static void elfw_init_ehdr(struct elf_writer* writer) {
 static struct elf_writer elfw_create() {
 	struct elf_writer writer;
 	elfw_init_ehdr(&writer);
-	writer.shstrtab = str_create(0);
-	str_append(&writer.shstrtab, 0);
+	writer.shstrtab = strtab_create();
 	writer.phdrtab = vec_create(sizeof(Elf32_Phdr));
-	writer.pbuftab = vec_create(sizeof(struct str));
+	writer.pbuftab = vec_create(sizeof(struct elfw_segbuf));
 	writer.shdrtab = vec_create(sizeof(Elf32_Shdr));
+	writer.shdr_name_ids = vec_create(sizeof(uint32_t));
 
 	// TODO: create the header for .text section
 	elfw_add_shdr(&writer, NULL, 0, 0, 0, 0, 0, 0);
@@ -78,12 +93,18 @@ static struct elf_writer elfw_create() {
 }
 
 static void elfw_free(struct elf_writer* writer) {
-	str_free(&writer->shstrtab);
+	strtab_free(&writer->shstrtab);
 	vec_free(&writer->phdrtab);
-	VEC_FOREACH(&writer->pbuftab, struct str, pbufptr) {
-		str_free(pbufptr);
+	VEC_FOREACH(&writer->pbuftab, struct elfw_segbuf, pbufptr) {
+		if (pbufptr->chunked) {
+			chunkbuf_free(&pbufptr->chunks);
+		} else {
+			str_free(&pbufptr->str);
+		}
 	}
 	vec_free(&writer->pbuftab);
+	vec_free(&writer->shdrtab);
+	vec_free(&writer->shdr_name_ids);
 }
 
 static Elf32_Phdr _elfw_create_phdr(uint32_t file_off, uint32_t va, uint32_t memsize, const char* name) {
@@ -144,11 +165,9 @@ static int elfw_add_shdr(struct elf_writer* writer, const char* name, uint32_t t
   Elf32_Shdr newsh;
   memset(&newsh, 0, sizeof(Elf32_Shdr));
 
-  int name_idx = 0;
-  if (name) {
-    name_idx = str_concat(&writer->shstrtab, name);
-  }
-  newsh.sh_name = name_idx;
+  // the offset is only written to the output by elfw_write
+  uint32_t name_id = strtab_add(&writer->shstrtab, name ? name : "");
+  vec_append(&writer->shdr_name_ids, &name_id);
   newsh.sh_type = type;
   newsh.sh_flags = flags;
   newsh.sh_link = link;
@@ -161,14 +180,13 @@ static int elfw_add_shdr(struct elf_writer* writer, const char* name, uint32_t t
 }
 
 /*
- * Create a segment header and record the buffer for the segment.
- *
- * Use by both the linker and unit test (called by elfw_manual_text)
+ * Name of the section header at shidx.
  */
-void elfw_create_segment(struct elf_writer *writer, const char* name, struct str *segbuf, int seglen) {
-  // XXX don't support a combined .text + .bss segment yet.
-  assert(segbuf->len == 0 || segbuf->len == seglen);
+static const char* elfw_get_shdr_name(struct elf_writer* writer, int shidx) {
+  return intern_get(&writer->shstrtab.names, *(uint32_t*) vec_get_item(&writer->shdr_name_ids, shidx));
+}
 
+static void _elfw_add_segment(struct elf_writer *writer, const char* name, struct elfw_segbuf *segbuf, int seglen) {
   // !!!This alignment is the key to make the generated ELF file work!
   writer->next_file_off = make_align(writer->next_file_off, 4096);
   writer->next_va = make_align(writer->next_va, 4096);
@@ -181,24 +199,60 @@ void elfw_create_segment(struct elf_writer *writer, const char* name, struct str
   writer->next_va = make_align(writer->next_va + phdr.p_memsz, ALIGN_BYTES);
 }
 
+/*
+ * Create a segment header and record the buffer for the segment.
+ *
+ * Use by both the linker and unit test (called by elfw_manual_text)
+ */
+void elfw_create_segment(struct elf_writer *writer, const char* name, struct str *segbuf, int seglen) {
+  // XXX don't support a combined .text + .bss segment yet.
+  assert(segbuf->len == 0 || segbuf->len == seglen);
+	struct elfw_segbuf buf = {0};
+	buf.str = *segbuf;
+	_elfw_add_segment(writer, name, &buf, seglen);
+}
+
+/*
+ * Same as elfw_create_segment but take the content as a chunkbuf, which is
+ * written out block by block with writev. Like the str passed to
+ * elfw_create_segment, the chunkbuf is freed by elfw_free.
+ */
+void elfw_create_chunked_segment(struct elf_writer *writer, const char* name, struct chunkbuf *segbuf, int seglen) {
+  assert(segbuf->len == 0 || segbuf->len == seglen);
+	struct elfw_segbuf buf = {0};
+	buf.chunked = true;
+	buf.chunks = *segbuf;
+	_elfw_add_segment(writer, name, &buf, seglen);
+}
+
+/*
+ * Write the ELF file. The first call decides the layout of the file; calling
+ * it again writes the same file, e.g. to another path. Nothing can be added
+ * to the writer after the first call.
+ */
 void elfw_write(struct elf_writer *writer, const char *out_path) {
-  // place the .shstrtab
   Elf32_Shdr* sh_shstrtab = vec_get_item(&writer->shdrtab, writer->ehdr.e_shstrndx);
-  sh_shstrtab->sh_size = writer->shstrtab.len;
-  elfw_place_section_to_layout(writer, sh_shstrtab); // will move writer->next_file_off
-
-  // decide the file offset for the program headers and section headers
-  writer->next_file_off = make_align(writer->next_file_off, ALIGN_BYTES);
   Elf32_Ehdr* ehdr = &writer->ehdr;
-  ehdr->e_phoff = writer->next_file_off;
-  ehdr->e_phnum = writer->phdrtab.len;
+  if (!writer->shstrtab.finalized) {
+    // lay out the section names
+    strtab_finalize(&writer->shstrtab);
+
+    // place the .shstrtab
+    sh_shstrtab->sh_size = strtab_size(&writer->shstrtab);
+    elfw_place_section_to_layout(writer, sh_shstrtab); // will move writer->next_file_off
 
-  writer->next_file_off = make_align(writer->next_file_off + sizeof(Elf32_Phdr) * ehdr->e_phnum, ALIGN_BYTES);
-  ehdr->e_shoff = writer->next_file_off;
-  ehdr->e_shnum = writer->shdrtab.len;
+    // decide the file offset for the program headers and section headers
+    writer->next_file_off = make_align(writer->next_file_off, ALIGN_BYTES);
+    ehdr->e_phoff = writer->next_file_off;
+    ehdr->e_phnum = writer->phdrtab.len;
 
-  // next_file_off could be incremented for the section header table size.
-  // But it's fine to skip since nobody read it afterwards
+    writer->next_file_off = make_align(writer->next_file_off + sizeof(Elf32_Phdr) * ehdr->e_phnum, ALIGN_BYTES);
+    ehdr->e_shoff = writer->next_file_off;
+    ehdr->e_shnum = writer->shdrtab.len;
+
+    // next_file_off could be incremented for the section header table size.
+    // But it's fine to skip since nobody read it afterwards
+  }
 
   // The layout of the output ELF file is completely decided. Start writing
   // the content of the file.
@@ -209,14 +263,22 @@ void elfw_write(struct elf_writer *writer, const char *out_path) {
   // write segment content
 	for (int i = 0; i < writer->phdrtab.len; ++i) {
 		Elf32_Phdr* phdr = vec_get_item(&writer->phdrtab, i);
-		struct str* pbuf = vec_get_item(&writer->pbuftab, i);
+		struct elfw_segbuf* pbuf = vec_get_item(&writer->pbuftab, i);
     fseek(fp, phdr->p_offset, SEEK_SET);
-    assert(pbuf->len == phdr->p_filesz);
-    fwrite(pbuf->buf, 1, phdr->p_filesz, fp);
+    if (pbuf->chunked) {
+      assert(pbuf->chunks.len == phdr->p_filesz);
+      // hand the blocks to the kernel directly, bypassing stdio
+      fflush(fp);
+      CHECK(lseek(fileno(fp), phdr->p_offset, SEEK_SET) == phdr->p_offset, "lseek fail");
+      chunkbuf_writev(&pbuf->chunks, fileno(fp));
+    } else {
+      assert(pbuf->str.len == phdr->p_filesz);
+      fwrite(pbuf->str.buf, 1, phdr->p_filesz, fp);
+    }
 	}
 
   // write .shstrtab
-  _elfw_write_section(fp, sh_shstrtab, writer->shstrtab.buf);
+  _elfw_write_section(fp, sh_shstrtab, writer->shstrtab.buf.buf);
 
   // write segment table
   fseek(fp, ehdr->e_phoff, SEEK_SET);
@@ -226,8 +288,10 @@ void elfw_write(struct elf_writer *writer, const char *out_path) {
 
   // write section table. An ELF without a NULL section will trigger warning
   // by running 'readelf -h'
-  VEC_FOREACH(&writer->shdrtab, Elf32_Shdr, shdr) {
-    fwrite(shdr, 1, sizeof(Elf32_Shdr), fp);
+  VEC_FOREACH_I(&writer->shdrtab, Elf32_Shdr, shdr, i) {
+    Elf32_Shdr out = *shdr;
+    out.sh_name = strtab_offset(&writer->shstrtab, *(uint32_t*) vec_get_item(&writer->shdr_name_ids, i));
+    fwrite(&out, 1, sizeof(Elf32_Shdr), fp);
   }
 
   fclose(fp);
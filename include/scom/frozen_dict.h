@@ -0,0 +1,365 @@
+#pragma once
+
+/*
+ * An immutable string -> integer dictionary for tables that never change
+ * after build time, e.g. the global symbol table of a frozen sysroot.
+ *
+ * frozen_dict_build turns a struct dict with 'char*' keys into a flat,
+ * position-independent image. The image can be written to a file and later
+ * mapped with frozen_dict_open. Opening only checks the header and that each
+ * table fits in the image, so it is O(1) no matter how many keys there are,
+ * and lookups read the mapping directly. A lookup checks that the key string
+ * of the slot it reads is inside the image too, so a corrupt or truncated
+ * file fails a CHECK instead of reading out of bounds.
+ *
+ * The keys are placed with a minimal perfect hash in the CHD (compress, hash
+ * and displace) style:
+ * - the n keys are split into about n / FROZEN_DICT_BUCKET_SIZE buckets by
+ *   one part of their hash.
+ * - buckets are placed from the largest to the smallest. For each bucket we
+ *   search a displacement (d0, d1) such that slot = (h1 + d0 * h2 + d1) % n
+ *   is free and distinct for all its keys.
+ * So a lookup reads one displacement and one slot, then compares the key.
+ *
+ * Values are stored as uint64_t. A void* value from the source dict is
+ * stored as its integer value.
+ *
+ * The image layout (native byte order, offsets from the start of the image):
+ *   struct frozen_dict_header
+ *   uint32_t disp[nbucket][2]        at disp_off
+ *   struct frozen_dict_slot[nkey]    at slot_off
+ *   '\0' terminated key strings      at str_off
+ */
+
+#include <stdint.h>
+#include <string.h>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "scom/check.h"
+#include "scom/util.h"
+#include "scom/hash.h"
+#include "scom/str.h"
+#include "scom/dict.h"
+
+#define FROZEN_DICT_MAGIC "SCOMFD01"
+#define FROZEN_DICT_BUCKET_SIZE 4
+// give up a seed once a bucket needs more than this many d0 values
+#define FROZEN_DICT_MAX_D0 64
+
+struct frozen_dict_header {
+	char magic[8];
+	uint64_t seed;
+	uint32_t nkey;
+	uint32_t nbucket;
+	uint32_t disp_off;
+	uint32_t slot_off;
+	uint32_t str_off;
+	uint32_t image_size;
+};
+
+struct frozen_dict_slot {
+	uint32_t key_off; // relative to str_off
+	uint32_t key_len;
+	uint64_t val;
+};
+
+struct frozen_dict {
+	const char *image;
+	const struct frozen_dict_header *hdr;
+	const uint32_t *disp;
+	const struct frozen_dict_slot *slots;
+	const char *strs;
+	uint32_t str_size; // bytes from strs to the end of the image
+	// set if the image was mapped by frozen_dict_open
+	void *map;
+	size_t map_size;
+};
+
+struct _frozen_key {
+	const char *key;
+	uint32_t len;
+	uint32_t h0, h1, h2;
+	uint64_t val;
+};
+
+static inline void _frozen_dict_hash(const char *key, uint32_t len, uint64_t seed, uint32_t *h0, uint32_t *h1, uint32_t *h2) {
+	uint64_t h = hash_bytes(key, len, seed);
+	uint64_t g = _hash_mum(h ^ _HASH_S2, _HASH_S0);
+	*h0 = (uint32_t) h;
+	*h1 = (uint32_t) (h >> 32);
+	*h2 = (uint32_t) g;
+}
+
+static inline uint32_t _frozen_dict_slot_idx(uint32_t h1, uint32_t h2, uint32_t d0, uint32_t d1, uint32_t nkey) {
+	return (uint32_t) (((uint64_t) h1 + (uint64_t) d0 * h2 + d1) % nkey);
+}
+
+/*
+ * Try to place all keys with the given seed. Fill disp and slot_of_key and
+ * return true on success.
+ */
+static bool _frozen_dict_place(struct _frozen_key *keys, uint32_t n, uint32_t nbucket, uint64_t seed, uint32_t *disp, uint32_t *slot_of_key) {
+	for (uint32_t i = 0; i < n; ++i) {
+		_frozen_dict_hash(keys[i].key, keys[i].len, seed, &keys[i].h0, &keys[i].h1, &keys[i].h2);
+	}
+
+	// counting sort the keys by bucket
+	uint32_t *bucket_start = (uint32_t*) calloc(nbucket + 1, sizeof(uint32_t));
+	uint32_t *order = (uint32_t*) malloc(sizeof(uint32_t) * n);
+	for (uint32_t i = 0; i < n; ++i) {
+		++bucket_start[keys[i].h0 % nbucket + 1];
+	}
+	uint32_t max_bucket_size = 0;
+	for (uint32_t b = 0; b < nbucket; ++b) {
+		if (bucket_start[b + 1] > max_bucket_size) {
+			max_bucket_size = bucket_start[b + 1];
+		}
+		bucket_start[b + 1] += bucket_start[b];
+	}
+	uint32_t *fill = (uint32_t*) malloc(sizeof(uint32_t) * nbucket);
+	memcpy(fill, bucket_start, sizeof(uint32_t) * nbucket);
+	for (uint32_t i = 0; i < n; ++i) {
+		order[fill[keys[i].h0 % nbucket]++] = i;
+	}
+
+	// counting sort the buckets by size, largest first
+	uint32_t *size_start = (uint32_t*) calloc(max_bucket_size + 2, sizeof(uint32_t));
+	uint32_t *buckets = (uint32_t*) malloc(sizeof(uint32_t) * nbucket);
+	for (uint32_t b = 0; b < nbucket; ++b) {
+		++size_start[max_bucket_size - (bucket_start[b + 1] - bucket_start[b]) + 1];
+	}
+	for (uint32_t s = 0; s <= max_bucket_size; ++s) {
+		size_start[s + 1] += size_start[s];
+	}
+	for (uint32_t b = 0; b < nbucket; ++b) {
+		buckets[size_start[max_bucket_size - (bucket_start[b + 1] - bucket_start[b])]++] = b;
+	}
+
+	uint8_t *taken = (uint8_t*) calloc(n, 1);
+	uint32_t *cand = (uint32_t*) malloc(sizeof(uint32_t) * (max_bucket_size + 1));
+	uint32_t free_slot = 0;
+	bool ok = true;
+	for (uint32_t bi = 0; bi < nbucket && ok; ++bi) {
+		uint32_t b = buckets[bi];
+		uint32_t first = bucket_start[b], size = bucket_start[b + 1] - first;
+		disp[2 * b] = disp[2 * b + 1] = 0;
+		if (size == 0) {
+			continue;
+		}
+		if (size == 1) {
+			// buckets come largest first, so only singletons are left. Point
+			// each straight at the next free slot with d0 = 0.
+			while (taken[free_slot]) {
+				++free_slot;
+			}
+			struct _frozen_key *key = &keys[order[first]];
+			taken[free_slot] = 1;
+			slot_of_key[order[first]] = free_slot;
+			disp[2 * b + 1] = (uint32_t) (((uint64_t) free_slot + n - key->h1 % n) % n);
+			continue;
+		}
+		bool placed = false;
+		for (uint32_t d0 = 0; d0 < FROZEN_DICT_MAX_D0 && !placed; ++d0) {
+			for (uint32_t d1 = 0; d1 < n && !placed; ++d1) {
+				uint32_t k = 0;
+				for (; k < size; ++k) {
+					struct _frozen_key *key = &keys[order[first + k]];
+					uint32_t slot = _frozen_dict_slot_idx(key->h1, key->h2, d0, d1, n);
+					if (taken[slot]) {
+						break;
+					}
+					uint32_t j = 0;
+					while (j < k && cand[j] != slot) {
+						++j;
+					}
+					if (j < k) {
+						break;
+					}
+					cand[k] = slot;
+				}
+				if (k == size) {
+					for (k = 0; k < size; ++k) {
+						taken[cand[k]] = 1;
+						slot_of_key[order[first + k]] = cand[k];
+					}
+					disp[2 * b] = d0;
+					disp[2 * b + 1] = d1;
+					placed = true;
+				}
+			}
+		}
+		// two keys of the bucket collide on h1 and h2. Need another seed.
+		ok = placed;
+	}
+
+	free(cand);
+	free(taken);
+	free(buckets);
+	free(size_start);
+	free(fill);
+	free(order);
+	free(bucket_start);
+	return ok;
+}
+
+/*
+ * Build the image for a dict with 'char*' keys. The values are stored as
+ * their integer value.
+ */
+static struct str frozen_dict_build(struct dict *src) {
+	uint32_t n = src->size;
+	uint32_t nbucket = n / FROZEN_DICT_BUCKET_SIZE + 1;
+	struct _frozen_key *keys = (struct _frozen_key*) malloc(sizeof(struct _frozen_key) * (n + 1));
+	uint32_t i = 0;
+	size_t str_size = 0;
+	DICT_FOREACH(src, entry) {
+		keys[i].key = (const char*) entry->key;
+		keys[i].len = strlen(keys[i].key);
+		keys[i].val = (uint64_t) (uintptr_t) entry->val;
+		str_size += keys[i].len + 1;
+		++i;
+	}
+	assert(i == n);
+
+	uint32_t *disp = (uint32_t*) malloc(sizeof(uint32_t) * 2 * nbucket);
+	uint32_t *slot_of_key = (uint32_t*) malloc(sizeof(uint32_t) * (n + 1));
+	uint64_t seed = 0;
+	while (!_frozen_dict_place(keys, n, nbucket, seed, disp, slot_of_key)) {
+		++seed;
+	}
+
+	struct frozen_dict_header hdr;
+	memset(&hdr, 0, sizeof(hdr));
+	memcpy(hdr.magic, FROZEN_DICT_MAGIC, sizeof(hdr.magic));
+	hdr.seed = seed;
+	hdr.nkey = n;
+	hdr.nbucket = nbucket;
+	hdr.disp_off = sizeof(hdr);
+	hdr.slot_off = make_align(hdr.disp_off + sizeof(uint32_t) * 2 * nbucket, 8);
+	hdr.str_off = hdr.slot_off + sizeof(struct frozen_dict_slot) * n;
+	uint64_t image_size = (uint64_t) hdr.str_off + str_size;
+	CHECK(image_size < INT32_MAX, "frozen dict image too large: %llu bytes", (unsigned long long) image_size);
+	hdr.image_size = image_size;
+
+	struct str image = str_create(hdr.image_size);
+	image.len = hdr.image_size;
+	memset(image.buf, 0, image.len);
+	memcpy(image.buf, &hdr, sizeof(hdr));
+	memcpy(image.buf + hdr.disp_off, disp, sizeof(uint32_t) * 2 * nbucket);
+	struct frozen_dict_slot *slots = (struct frozen_dict_slot*) (image.buf + hdr.slot_off);
+	uint32_t str_pos = 0;
+	for (i = 0; i < n; ++i) {
+		struct frozen_dict_slot *slot = &slots[slot_of_key[i]];
+		slot->key_off = str_pos;
+		slot->key_len = keys[i].len;
+		slot->val = keys[i].val;
+		memcpy(image.buf + hdr.str_off + str_pos, keys[i].key, keys[i].len + 1);
+		str_pos += keys[i].len + 1;
+	}
+
+	free(slot_of_key);
+	free(disp);
+	free(keys);
+	return image;
+}
+
+/*
+ * Use an image in memory. The caller keeps the buffer alive and 8 byte
+ * aligned.
+ */
+static struct frozen_dict frozen_dict_from_buffer(const void *buf, size_t size) {
+	struct frozen_dict fd;
+	memset(&fd, 0, sizeof(fd));
+	fd.image = (const char*) buf;
+	fd.hdr = (const struct frozen_dict_header*) buf;
+	CHECK(size >= sizeof(struct frozen_dict_header)
+		&& memcmp(fd.hdr->magic, FROZEN_DICT_MAGIC, sizeof(fd.hdr->magic)) == 0
+		&& fd.hdr->image_size <= size, "not a frozen dict image");
+	const struct frozen_dict_header *hdr = fd.hdr;
+	// 64 bit math so offset + length can't wrap
+	uint64_t image_size = hdr->image_size;
+	CHECK(hdr->nbucket > 0 || hdr->nkey == 0, "bad frozen dict image: no buckets for %u keys", hdr->nkey);
+	CHECK(hdr->disp_off >= sizeof(struct frozen_dict_header) && hdr->disp_off % sizeof(uint32_t) == 0
+		&& hdr->disp_off + (uint64_t) hdr->nbucket * 2 * sizeof(uint32_t) <= image_size,
+		"bad frozen dict image: displacements at %u out of range", hdr->disp_off);
+	CHECK(hdr->slot_off >= sizeof(struct frozen_dict_header) && hdr->slot_off % 8 == 0
+		&& hdr->slot_off + (uint64_t) hdr->nkey * sizeof(struct frozen_dict_slot) <= image_size,
+		"bad frozen dict image: slots at %u out of range", hdr->slot_off);
+	CHECK(hdr->str_off >= sizeof(struct frozen_dict_header) && hdr->str_off <= image_size,
+		"bad frozen dict image: strings at %u out of range", hdr->str_off);
+	fd.str_size = image_size - hdr->str_off;
+	fd.disp = (const uint32_t*) (fd.image + fd.hdr->disp_off);
+	fd.slots = (const struct frozen_dict_slot*) (fd.image + fd.hdr->slot_off);
+	fd.strs = fd.image + fd.hdr->str_off;
+	return fd;
+}
+
+static void frozen_dict_write(struct str *image, const char *path) {
+	FILE *fp = fopen(path, "wb");
+	CHECK(fp, "fail to open %s", path);
+	CHECK(fwrite(image->buf, 1, image->len, fp) == (size_t) image->len, "fail to write %s", path);
+	fclose(fp);
+}
+
+/*
+ * Map the image file read-only.
+ */
+static struct frozen_dict frozen_dict_open(const char *path) {
+	int fd = open(path, O_RDONLY);
+	CHECK(fd >= 0, "fail to open %s", path);
+	struct stat st;
+	int status = fstat(fd, &st);
+	assert(status == 0);
+	void *map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	CHECK(map != MAP_FAILED, "fail to mmap %s", path);
+	close(fd);
+	struct frozen_dict fdict = frozen_dict_from_buffer(map, st.st_size);
+	fdict.map = map;
+	fdict.map_size = st.st_size;
+	return fdict;
+}
+
+static void frozen_dict_close(struct frozen_dict *fd) {
+	if (fd->map) {
+		munmap(fd->map, fd->map_size);
+	}
+	memset(fd, 0, sizeof(*fd));
+}
+
+/*
+ * Look up the first 'len' bytes of key. If found, store the value to *pval
+ * (when pval is not NULL) and return true.
+ */
+static bool frozen_dict_lenfind(const struct frozen_dict *fd, const char *key, uint32_t len, uint64_t *pval) {
+	uint32_t n = fd->hdr->nkey;
+	if (n == 0) {
+		return false;
+	}
+	uint32_t h0, h1, h2;
+	_frozen_dict_hash(key, len, fd->hdr->seed, &h0, &h1, &h2);
+	const uint32_t *d = fd->disp + 2 * (h0 % fd->hdr->nbucket);
+	const struct frozen_dict_slot *slot = &fd->slots[_frozen_dict_slot_idx(h1, h2, d[0], d[1], n)];
+	if (slot->key_len != len) {
+		return false;
+	}
+	CHECK((uint64_t) slot->key_off + len < fd->str_size,
+		"bad frozen dict image: key at %u of length %u out of range", slot->key_off, len);
+	if (memcmp(fd->strs + slot->key_off, key, len) != 0) {
+		return false;
+	}
+	if (pval) {
+		*pval = slot->val;
+	}
+	return true;
+}
+
+static bool frozen_dict_find(const struct frozen_dict *fd, const char *key, uint64_t *pval) {
+	return frozen_dict_lenfind(fd, key, strlen(key), pval);
+}
+
+static uint32_t frozen_dict_size(const struct frozen_dict *fd) {
+	return fd->hdr->nkey;
+}
@@ -0,0 +1,203 @@
+#pragma once
+
+/*
+ * Byte string hash functions used by the containers.
+ *
+ * - hash_bytes: a wyhash style hash consuming 16 bytes per round with a
+ *   64x64->128 bit multiply. Fast on long keys and well mixed even when keys
+ *   share a long prefix like mangled C++ names.
+ * - hash_crc32c: CRC32C of the bytes followed by a finalizer. Uses the SSE4.2
+ *   crc32 instruction if the CPU supports it, otherwise a table driven
+ *   software implementation. Both give the same result.
+ *
+ * Both take a seed. hash_random_seed returns a different seed on each call
+ * that is unpredictable across processes, so tables using it are not
+ * vulnerable to inputs crafted to collide.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <stdio.h>
+#include <time.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define HASH_HAVE_X86 1
+#include <nmmintrin.h>
+#endif
+
+static inline uint64_t _hash_read64(const uint8_t *p) {
+	uint64_t v;
+	memcpy(&v, p, sizeof(v));
+	return v;
+}
+
+static inline uint64_t _hash_read32(const uint8_t *p) {
+	uint32_t v;
+	memcpy(&v, p, sizeof(v));
+	return v;
+}
+
+/*
+ * Multiply two 64 bit numbers and fold the 128 bit product into 64 bits.
+ */
+static inline uint64_t _hash_mum(uint64_t a, uint64_t b) {
+#ifdef __SIZEOF_INT128__
+	__uint128_t r = (__uint128_t) a * b;
+	return (uint64_t) r ^ (uint64_t) (r >> 64);
+#else
+	// no 128 bit integer on 32 bit targets. Multiply the 32 bit halves.
+	uint64_t ha = a >> 32, hb = b >> 32, la = (uint32_t) a, lb = (uint32_t) b;
+	uint64_t rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb;
+	uint64_t t = rl + (rm0 << 32);
+	uint64_t carry = t < rl;
+	uint64_t lo = t + (rm1 << 32);
+	carry += lo < t;
+	uint64_t hi = rh + (rm0 >> 32) + (rm1 >> 32) + carry;
+	return lo ^ hi;
+#endif
+}
+
+static inline uint32_t _hash_fold32(uint64_t h) {
+	return (uint32_t) (h ^ (h >> 32));
+}
+
+#define _HASH_S0 0xa0761d6478bd642full
+#define _HASH_S1 0xe7037ed1a0b428dbull
+#define _HASH_S2 0x8ebc6af09c88c6e3ull
+
+static inline uint64_t hash_bytes(const void *data, size_t len, uint64_t seed) {
+	const uint8_t *p = (const uint8_t*) data;
+	uint64_t a, b;
+	seed ^= _hash_mum(seed ^ _HASH_S0, _HASH_S1);
+	if (len <= 16) {
+		if (len >= 4) {
+			// two possibly overlapping 8 byte windows built from 4 byte reads
+			size_t off = (len >> 3) << 2;
+			a = (_hash_read32(p) << 32) | _hash_read32(p + off);
+			b = (_hash_read32(p + len - 4) << 32) | _hash_read32(p + len - 4 - off);
+		} else if (len > 0) {
+			a = ((uint64_t) p[0] << 16) | ((uint64_t) p[len >> 1] << 8) | p[len - 1];
+			b = 0;
+		} else {
+			a = b = 0;
+		}
+	} else {
+		size_t i = len;
+		for (; i > 16; i -= 16, p += 16) {
+			seed = _hash_mum(_hash_read64(p) ^ _HASH_S1, _hash_read64(p + 8) ^ seed);
+		}
+		// the last 16 bytes, overlapping with the previous round if needed
+		a = _hash_read64(p + i - 16);
+		b = _hash_read64(p + i - 8);
+	}
+	return _hash_mum(_HASH_S1 ^ len, _hash_mum(a ^ _HASH_S1, b ^ seed) ^ _HASH_S2);
+}
+
+static inline uint32_t _hash_fmix32(uint32_t h) {
+	h ^= h >> 16;
+	h *= 0x85ebca6b;
+	h ^= h >> 13;
+	h *= 0xc2b2ae35;
+	h ^= h >> 16;
+	return h;
+}
+
+static uint32_t _hash_crc32c_sw(const uint8_t *p, size_t len, uint32_t crc) {
+	static uint32_t table[256];
+	static int table_ready = 0;
+	if (!table_ready) {
+		for (uint32_t i = 0; i < 256; ++i) {
+			uint32_t c = i;
+			for (int k = 0; k < 8; ++k) {
+				c = (c >> 1) ^ (0x82F63B78 & (0 - (c & 1)));
+			}
+			table[i] = c;
+		}
+		table_ready = 1;
+	}
+	for (size_t i = 0; i < len; ++i) {
+		crc = table[(crc ^ p[i]) & 0xff] ^ (crc >> 8);
+	}
+	return crc;
+}
+
+#ifdef HASH_HAVE_X86
+__attribute__((target("sse4.2")))
+static uint32_t _hash_crc32c_hw(const uint8_t *p, size_t len, uint32_t crc) {
+#ifdef __x86_64__
+	uint64_t crc64 = crc;
+	for (; len >= 8; len -= 8, p += 8) {
+		crc64 = _mm_crc32_u64(crc64, _hash_read64(p));
+	}
+	crc = (uint32_t) crc64;
+#endif
+	for (; len >= 4; len -= 4, p += 4) {
+		crc = _mm_crc32_u32(crc, (uint32_t) _hash_read32(p));
+	}
+	for (; len > 0; --len, ++p) {
+		crc = _mm_crc32_u8(crc, *p);
+	}
+	return crc;
+}
+#endif
+
+/*
+ * Whether hash_crc32c runs on the SSE4.2 crc32 instruction.
+ */
+static int hash_crc32c_is_hw() {
+#ifdef HASH_HAVE_X86
+	static int supported = -1;
+	if (supported < 0) {
+		supported = __builtin_cpu_supports("sse4.2") ? 1 : 0;
+	}
+	return supported;
+#else
+	return 0;
+#endif
+}
+
+static inline uint32_t hash_crc32c(const void *data, size_t len, uint32_t seed) {
+	const uint8_t *p = (const uint8_t*) data;
+	uint32_t crc = ~seed;
+#ifdef HASH_HAVE_X86
+	if (hash_crc32c_is_hw()) {
+		crc = _hash_crc32c_hw(p, len, crc);
+	} else {
+		crc = _hash_crc32c_sw(p, len, crc);
+	}
+#else
+	crc = _hash_crc32c_sw(p, len, crc);
+#endif
+	// CRC is linear, mix the bits before the low bits are used as table index
+	return _hash_fmix32(~crc ^ (uint32_t) len);
+}
+
+static inline uint64_t _hash_splitmix64(uint64_t *state) {
+	uint64_t z = (*state += 0x9e3779b97f4a7c15ull);
+	z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+	z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+	return z ^ (z >> 31);
+}
+
+/*
+ * Return a new random seed. The first call reads /dev/urandom, later calls
+ * derive new seeds from it.
+ * Not thread safe.
+ */
+static uint64_t hash_random_seed() {
+	static uint64_t state = 0;
+	static int initialized = 0;
+	if (!initialized) {
+		FILE *fp = fopen("/dev/urandom", "rb");
+		if (!fp || fread(&state, sizeof(state), 1, fp) != 1) {
+			// fall back to something that differs across runs
+			state = (uint64_t) time(NULL) ^ (uint64_t) (uintptr_t) &state;
+		}
+		if (fp) {
+			fclose(fp);
+		}
+		initialized = 1;
+	}
+	return _hash_splitmix64(&state);
+}
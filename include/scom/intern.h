@@ -0,0 +1,137 @@
+#pragma once
+
+/*
+ * An atom table mapping strings to dense uint32_t IDs.
+ *
+ * Each distinct string is stored once. IDs are assigned in interning order
+ * starting from 0 and stay valid, as do the pointers returned by intern_get,
+ * until intern_free. After interning, comparing two strings is an integer
+ * compare and later maps can be keyed by ID.
+ *
+ * The strings live in fixed size chunks that are never reallocated, so the
+ * string -> ID dict can point its keys right into them.
+ */
+
+#include <stdint.h>
+#include <string.h>
+#include "scom/str.h"
+#include "scom/vec.h"
+#include "scom/dict.h"
+
+#define INTERN_CHUNK_SIZE 65536
+#define INTERN_NONE UINT32_MAX
+
+struct intern {
+	struct vec chunks; // struct str. Only the last one gets new strings.
+	struct vec strs; // const char*. ID -> string.
+	struct dict ids; // string -> ID. Keys point into chunks.
+};
+
+static struct intern intern_create() {
+	struct intern in;
+	in.chunks = vec_create(sizeof(struct str));
+	in.strs = vec_create(sizeof(const char*));
+	in.ids = dict_create(str_hash_fn, str_eq_fn, 0, 0);
+	return in;
+}
+
+static void intern_free(struct intern* in) {
+	VEC_FOREACH(&in->chunks, struct str, chunk) {
+		str_free(chunk);
+	}
+	vec_free(&in->chunks);
+	vec_free(&in->strs);
+	dict_free(&in->ids);
+}
+
+/*
+ * Copy the string to the end of the current chunk (starting a new one if it
+ * does not fit) and return the copy.
+ */
+static char* _intern_copy(struct intern* in, const char* s, int len) {
+	struct str* chunk = in->chunks.len > 0 ? (struct str*) vec_get_item(&in->chunks, in->chunks.len - 1) : NULL;
+	if (!chunk || chunk->len + len + 1 > chunk->capacity) {
+		int capa = len + 1 > INTERN_CHUNK_SIZE ? len + 1 : INTERN_CHUNK_SIZE;
+		struct str newchunk = str_create(capa);
+		vec_append(&in->chunks, &newchunk);
+		chunk = (struct str*) vec_get_item(&in->chunks, in->chunks.len - 1);
+	}
+	// never grows past capacity so the buffer does not move
+	int off = str_lenconcat(chunk, s, len);
+	str_append(chunk, '\0');
+	return chunk->buf + off;
+}
+
+/*
+ * Intern the first 'len' bytes of 's', which must not contain '\0'.
+ * Return the ID.
+ *
+ * Most strings interned are duplicates, so they are looked up in place with
+ * dict_find_view and only copied into a chunk on a miss.
+ */
+static uint32_t intern_lenstr(struct intern* in, const char* s, int len) {
+	struct dict_entry* entry = dict_find_view(&in->ids, strview_create(s, len));
+	if (entry) {
+		return (uint32_t) (uintptr_t) entry->val;
+	}
+	char* copy = _intern_copy(in, s, len);
+	uint32_t id = in->strs.len;
+	dict_put(&in->ids, copy, (void*) (uintptr_t) id);
+	vec_append(&in->strs, &copy);
+	return id;
+}
+
+static uint32_t intern_str(struct intern* in, const char* s) {
+	return intern_lenstr(in, s, strlen(s));
+}
+
+/*
+ * Return the ID of the string, or INTERN_NONE if it has never been interned.
+ */
+static uint32_t intern_find(struct intern* in, const char* s) {
+	struct dict_entry* entry = dict_find(&in->ids, (void*) s);
+	return entry ? (uint32_t) (uintptr_t) entry->val : INTERN_NONE;
+}
+
+/*
+ * Return the interned string for the ID.
+ */
+static const char* intern_get(struct intern* in, uint32_t id) {
+	return *(const char**) vec_get_item(&in->strs, id);
+}
+
+/*
+ * Number of distinct strings interned.
+ */
+static int intern_size(struct intern* in) {
+	return in->strs.len;
+}
+
+/*
+ * Intern every '\0' terminated string of a string table section like .strtab
+ * or .shstrtab. For each non-empty string, its offset in the section is
+ * appended to 'offsets' and its ID to 'ids' (both uint32_t), so offsets[i] and
+ * ids[i] belong together. Either vec can be NULL.
+ *
+ * Empty strings, including the leading one at offset 0, are skipped, so index
+ * i is not the i-th string of the section when the table has empty strings.
+ */
+static void intern_strtab(struct intern* in, const char* strtab, int size, struct vec* offsets, struct vec* ids) {
+	int off = 0;
+	while (off < size) {
+		const char* end = (const char*) memchr(strtab + off, '\0', size - off);
+		CHECK(end != NULL, "string table is not '\\0' terminated");
+		int len = end - (strtab + off);
+		if (len > 0) {
+			uint32_t id = intern_lenstr(in, strtab + off, len);
+			uint32_t off32 = off;
+			if (offsets) {
+				vec_append(offsets, &off32);
+			}
+			if (ids) {
+				vec_append(ids, &id);
+			}
+		}
+		off += len + 1;
+	}
+}
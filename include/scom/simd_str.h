@@ -0,0 +1,347 @@
+#pragma once
+
+/*
+ * Bulk byte string kernels for the symbol matching paths.
+ *
+ * - simd_mismatch/simd_memeq: compare two buffers of known length.
+ * - simd_find_any: find the first occurrence of any of k needles, e.g. a set
+ *   of symbol names in a .strtab, in one pass over the haystack.
+ * - simd_count_byte/simd_count_strings: count a byte, e.g. the '\0's that end
+ *   the strings of a string table.
+ *
+ * Each kernel has an AVX2, an SSE2 and a scalar version. The version is
+ * picked at runtime from what the CPU supports, like hash_crc32c, so the
+ * code does not have to be built with -mavx2. All versions give the same
+ * result.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <assert.h>
+#include "scom/strview.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define SIMD_STR_HAVE_X86 1
+#include <immintrin.h>
+#endif
+
+// max number of needles of simd_find_any
+#define SIMD_FIND_MAX_NEEDLES 32
+
+enum simd_level {
+	SIMD_SCALAR,
+	SIMD_SSE2,
+	SIMD_AVX2,
+};
+
+static enum simd_level _simd_detect_level() {
+#ifdef SIMD_STR_HAVE_X86
+	if (__builtin_cpu_supports("avx2")) {
+		return SIMD_AVX2;
+	}
+	if (__builtin_cpu_supports("sse2")) {
+		return SIMD_SSE2;
+	}
+#endif
+	return SIMD_SCALAR;
+}
+
+static int _simd_level = -1;
+
+/*
+ * The version the kernels use. Detected on the first call.
+ */
+static enum simd_level simd_str_level() {
+	if (_simd_level < 0) {
+		_simd_level = _simd_detect_level();
+	}
+	return (enum simd_level) _simd_level;
+}
+
+/*
+ * Use 'level', or the best supported one below it. Return the level in use.
+ * For the tests and benchmarks to compare the versions.
+ */
+static enum simd_level simd_str_set_level(enum simd_level level) {
+	enum simd_level supported = _simd_detect_level();
+	_simd_level = level < supported ? level : supported;
+	return (enum simd_level) _simd_level;
+}
+
+static const char *simd_level_name(enum simd_level level) {
+	switch (level) {
+	case SIMD_AVX2:
+		return "avx2";
+	case SIMD_SSE2:
+		return "sse2";
+	default:
+		return "scalar";
+	}
+}
+
+/* scalar versions. They also handle the tails of the vector versions. */
+
+static size_t _simd_mismatch_scalar(const uint8_t *a, const uint8_t *b, size_t n) {
+	size_t i = 0;
+	for (; i + 8 <= n; i += 8) {
+		uint64_t x, y;
+		memcpy(&x, a + i, 8);
+		memcpy(&y, b + i, 8);
+		if (x != y) {
+			// little endian: the lowest differing bit is in the first differing byte
+			return i + __builtin_ctzll(x ^ y) / 8;
+		}
+	}
+	for (; i < n; ++i) {
+		if (a[i] != b[i]) {
+			break;
+		}
+	}
+	return i;
+}
+
+static size_t _simd_count_byte_scalar(const uint8_t *p, size_t n, uint8_t ch) {
+	size_t cnt = 0;
+	for (size_t i = 0; i < n; ++i) {
+		cnt += p[i] == ch;
+	}
+	return cnt;
+}
+
+/*
+ * Search the starting positions from 'from' on.
+ */
+static const char *_simd_find_any_scalar(const char *hay, size_t len, size_t from, const struct strview *needles, int k, int *which) {
+	for (size_t i = from; i < len; ++i) {
+		for (int j = 0; j < k; ++j) {
+			if (hay[i] == needles[j].ptr[0] && needles[j].len <= len - i
+					&& memcmp(hay + i, needles[j].ptr, needles[j].len) == 0) {
+				*which = j;
+				return hay + i;
+			}
+		}
+	}
+	return NULL;
+}
+
+#ifdef SIMD_STR_HAVE_X86
+__attribute__((target("sse2")))
+static size_t _simd_mismatch_sse2(const uint8_t *a, const uint8_t *b, size_t n) {
+	size_t i = 0;
+	// two blocks per check while they are equal
+	for (; i + 32 <= n; i += 32) {
+		__m128i eq0 = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*) (a + i)), _mm_loadu_si128((const __m128i*) (b + i)));
+		__m128i eq1 = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*) (a + i + 16)), _mm_loadu_si128((const __m128i*) (b + i + 16)));
+		if (_mm_movemask_epi8(_mm_and_si128(eq0, eq1)) != 0xffff) {
+			break;
+		}
+	}
+	for (; i + 16 <= n; i += 16) {
+		__m128i x = _mm_loadu_si128((const __m128i*) (a + i));
+		__m128i y = _mm_loadu_si128((const __m128i*) (b + i));
+		uint32_t neq = ~(uint32_t) _mm_movemask_epi8(_mm_cmpeq_epi8(x, y)) & 0xffff;
+		if (neq) {
+			return i + __builtin_ctz(neq);
+		}
+	}
+	return i + _simd_mismatch_scalar(a + i, b + i, n - i);
+}
+
+__attribute__((target("avx2")))
+static size_t _simd_mismatch_avx2(const uint8_t *a, const uint8_t *b, size_t n) {
+	size_t i = 0;
+	// two blocks per check while they are equal
+	for (; i + 64 <= n; i += 64) {
+		__m256i eq0 = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*) (a + i)), _mm256_loadu_si256((const __m256i*) (b + i)));
+		__m256i eq1 = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*) (a + i + 32)), _mm256_loadu_si256((const __m256i*) (b + i + 32)));
+		if (~(uint32_t) _mm256_movemask_epi8(_mm256_and_si256(eq0, eq1))) {
+			break;
+		}
+	}
+	for (; i + 32 <= n; i += 32) {
+		__m256i x = _mm256_loadu_si256((const __m256i*) (a + i));
+		__m256i y = _mm256_loadu_si256((const __m256i*) (b + i));
+		uint32_t neq = ~(uint32_t) _mm256_movemask_epi8(_mm256_cmpeq_epi8(x, y));
+		if (neq) {
+			return i + __builtin_ctz(neq);
+		}
+	}
+	return i + _simd_mismatch_scalar(a + i, b + i, n - i);
+}
+
+/*
+ * A match gives -1 in its byte lane, so subtracting the compare result counts
+ * per lane. The lanes are summed with psadbw before they can overflow.
+ */
+__attribute__((target("sse2")))
+static size_t _simd_count_byte_sse2(const uint8_t *p, size_t n, uint8_t ch) {
+	__m128i needle = _mm_set1_epi8((char) ch);
+	__m128i total = _mm_setzero_si128();
+	size_t i = 0;
+	while (i + 16 <= n) {
+		__m128i acc = _mm_setzero_si128();
+		for (int round = 0; round < 255 && i + 16 <= n; ++round, i += 16) {
+			__m128i block = _mm_loadu_si128((const __m128i*) (p + i));
+			acc = _mm_sub_epi8(acc, _mm_cmpeq_epi8(block, needle));
+		}
+		total = _mm_add_epi64(total, _mm_sad_epu8(acc, _mm_setzero_si128()));
+	}
+	uint64_t lanes[2];
+	_mm_storeu_si128((__m128i*) lanes, total);
+	return lanes[0] + lanes[1] + _simd_count_byte_scalar(p + i, n - i, ch);
+}
+
+__attribute__((target("avx2")))
+static size_t _simd_count_byte_avx2(const uint8_t *p, size_t n, uint8_t ch) {
+	__m256i needle = _mm256_set1_epi8((char) ch);
+	__m256i total = _mm256_setzero_si256();
+	size_t i = 0;
+	while (i + 32 <= n) {
+		__m256i acc = _mm256_setzero_si256();
+		for (int round = 0; round < 255 && i + 32 <= n; ++round, i += 32) {
+			__m256i block = _mm256_loadu_si256((const __m256i*) (p + i));
+			acc = _mm256_sub_epi8(acc, _mm256_cmpeq_epi8(block, needle));
+		}
+		total = _mm256_add_epi64(total, _mm256_sad_epu8(acc, _mm256_setzero_si256()));
+	}
+	uint64_t lanes[4];
+	_mm256_storeu_si256((__m256i*) lanes, total);
+	return lanes[0] + lanes[1] + lanes[2] + lanes[3] + _simd_count_byte_scalar(p + i, n - i, ch);
+}
+
+/*
+ * For each block of starting positions, a needle is a candidate where both
+ * its first and its last byte match. Only candidates are compared in full,
+ * in the order of their position so the first occurrence wins.
+ */
+__attribute__((target("sse2")))
+static const char *_simd_find_any_sse2(const char *hay, size_t len, const struct strview *needles, int k, size_t maxlen, int *which) {
+	uint32_t masks[SIMD_FIND_MAX_NEEDLES];
+	size_t i = 0;
+	for (; i + 16 + maxlen - 1 <= len; i += 16) {
+		uint32_t any = 0;
+		__m128i first = _mm_loadu_si128((const __m128i*) (hay + i));
+		for (int j = 0; j < k; ++j) {
+			__m128i last = _mm_loadu_si128((const __m128i*) (hay + i + needles[j].len - 1));
+			__m128i m = _mm_and_si128(_mm_cmpeq_epi8(first, _mm_set1_epi8(needles[j].ptr[0])),
+				_mm_cmpeq_epi8(last, _mm_set1_epi8(needles[j].ptr[needles[j].len - 1])));
+			masks[j] = (uint32_t) _mm_movemask_epi8(m);
+			any |= masks[j];
+		}
+		for (; any; any &= any - 1) {
+			int bit = __builtin_ctz(any);
+			for (int j = 0; j < k; ++j) {
+				if ((masks[j] >> bit & 1) && memcmp(hay + i + bit + 1, needles[j].ptr + 1, needles[j].len - 1) == 0) {
+					*which = j;
+					return hay + i + bit;
+				}
+			}
+		}
+	}
+	return _simd_find_any_scalar(hay, len, i, needles, k, which);
+}
+
+__attribute__((target("avx2")))
+static const char *_simd_find_any_avx2(const char *hay, size_t len, const struct strview *needles, int k, size_t maxlen, int *which) {
+	uint32_t masks[SIMD_FIND_MAX_NEEDLES];
+	size_t i = 0;
+	for (; i + 32 + maxlen - 1 <= len; i += 32) {
+		uint32_t any = 0;
+		__m256i first = _mm256_loadu_si256((const __m256i*) (hay + i));
+		for (int j = 0; j < k; ++j) {
+			__m256i last = _mm256_loadu_si256((const __m256i*) (hay + i + needles[j].len - 1));
+			__m256i m = _mm256_and_si256(_mm256_cmpeq_epi8(first, _mm256_set1_epi8(needles[j].ptr[0])),
+				_mm256_cmpeq_epi8(last, _mm256_set1_epi8(needles[j].ptr[needles[j].len - 1])));
+			masks[j] = (uint32_t) _mm256_movemask_epi8(m);
+			any |= masks[j];
+		}
+		for (; any; any &= any - 1) {
+			int bit = __builtin_ctz(any);
+			for (int j = 0; j < k; ++j) {
+				if ((masks[j] >> bit & 1) && memcmp(hay + i + bit + 1, needles[j].ptr + 1, needles[j].len - 1) == 0) {
+					*which = j;
+					return hay + i + bit;
+				}
+			}
+		}
+	}
+	return _simd_find_any_scalar(hay, len, i, needles, k, which);
+}
+#endif
+
+/*
+ * Index of the first byte where a and b differ, or n if the n bytes are equal.
+ */
+static inline size_t simd_mismatch(const void *a, const void *b, size_t n) {
+	const uint8_t *x = (const uint8_t*) a, *y = (const uint8_t*) b;
+#ifdef SIMD_STR_HAVE_X86
+	switch (simd_str_level()) {
+	case SIMD_AVX2:
+		return _simd_mismatch_avx2(x, y, n);
+	case SIMD_SSE2:
+		return _simd_mismatch_sse2(x, y, n);
+	default:
+		break;
+	}
+#endif
+	return _simd_mismatch_scalar(x, y, n);
+}
+
+static inline int simd_memeq(const void *a, const void *b, size_t n) {
+	return simd_mismatch(a, b, n) == n;
+}
+
+/*
+ * Number of bytes equal to 'ch' in [p, p + n).
+ */
+static inline size_t simd_count_byte(const void *p, size_t n, char ch) {
+	const uint8_t *s = (const uint8_t*) p;
+#ifdef SIMD_STR_HAVE_X86
+	switch (simd_str_level()) {
+	case SIMD_AVX2:
+		return _simd_count_byte_avx2(s, n, (uint8_t) ch);
+	case SIMD_SSE2:
+		return _simd_count_byte_sse2(s, n, (uint8_t) ch);
+	default:
+		break;
+	}
+#endif
+	return _simd_count_byte_scalar(s, n, (uint8_t) ch);
+}
+
+/*
+ * Number of '\0' terminated strings in a string table of n bytes. This
+ * includes the empty string at offset 0 of an ELF string table.
+ */
+static inline size_t simd_count_strings(const char *buf, size_t n) {
+	return simd_count_byte(buf, n, '\0');
+}
+
+/*
+ * Return the first position in hay where one of the k needles occurs, and
+ * store the index of that needle to *which (the lowest one if several start
+ * there). Return NULL if none does.
+ *
+ * Needles must not be empty. To match whole names in a string table, include
+ * the '\0's around them in the needle, e.g. "\0main\0" with length 6.
+ */
+static inline const char *simd_find_any(const char *hay, size_t len, const struct strview *needles, int k, int *which) {
+	assert(k > 0 && k <= SIMD_FIND_MAX_NEEDLES);
+	size_t maxlen = 0;
+	for (int j = 0; j < k; ++j) {
+		assert(needles[j].len > 0);
+		maxlen = needles[j].len > maxlen ? needles[j].len : maxlen;
+	}
+#ifdef SIMD_STR_HAVE_X86
+	switch (simd_str_level()) {
+	case SIMD_AVX2:
+		return _simd_find_any_avx2(hay, len, needles, k, maxlen, which);
+	case SIMD_SSE2:
+		return _simd_find_any_sse2(hay, len, needles, k, maxlen, which);
+	default:
+		break;
+	}
+#endif
+	return _simd_find_any_scalar(hay, len, 0, needles, k, which);
+}
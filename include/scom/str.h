@@ -2,14 +2,25 @@
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <limits.h>
 #include <assert.h>
 #include <string.h>
+#include "scom/check.h"
+#include "scom/util.h"
+#include "scom/alloc.h"
 
 // variable length string
 struct str {
   int capacity;
 	int len;
 	char *buf;
+	// buf points to storage provided to str_create_inline rather than heap
+	// memory. Growing past it moves the content to the heap.
+	bool buf_inline;
+	// where buf comes from. NULL for libc.
+	struct allocator* alloc;
 };
 
 /*
@@ -20,6 +31,8 @@ static inline struct str str_create(int init_capa) {
 	struct str str;
 	str.capacity = init_capa;
 	str.len = 0;
+	str.buf_inline = false;
+	str.alloc = NULL;
   if (str.capacity > 0) {
   	str.buf = (char*) malloc(str.capacity);
   } else {
@@ -28,17 +41,89 @@ static inline struct str str_create(int init_capa) {
 	return str;
 }
 
+/*
+ * Same as str_create but take memory from 'alloc'.
+ */
+static inline struct str str_create_with_alloc(int init_capa, struct allocator* alloc) {
+	struct str str = str_create(0);
+	str.alloc = alloc;
+	str.capacity = init_capa;
+	if (str.capacity > 0) {
+		str.buf = (char*) alloc_malloc(alloc, str.capacity);
+	}
+	return str;
+}
+
+/*
+ * Create a str that keeps up to 'capacity' bytes in 'storage' and only
+ * allocates once it grows past that. The storage must outlive the str (or at
+ * least its use of the storage), e.g. a local array in the same scope:
+ *
+ *   char buf[32];
+ *   struct str name = STR_CREATE_INLINE(buf);
+ *
+ * Everything else, including str_free, works the same as for str_create.
+ */
+static inline struct str str_create_inline(char* storage, int capacity) {
+	struct str str = str_create(0);
+	str.buf = storage;
+	str.capacity = capacity;
+	str.buf_inline = true;
+	return str;
+}
+
+#define STR_CREATE_INLINE(storage) str_create_inline(storage, sizeof(storage))
+
+/*
+ * Set the capacity to exactly 'capacity' bytes, which must be no less than
+ * len.
+ */
+static inline void _str_set_capacity(struct str* pstr, int capacity) {
+	assert(capacity >= pstr->len);
+	pstr->capacity = capacity;
+	if (pstr->buf_inline) {
+		// spill to the heap
+		char* buf = (char*) alloc_malloc(pstr->alloc, pstr->capacity);
+		memcpy(buf, pstr->buf, pstr->len);
+		pstr->buf = buf;
+		pstr->buf_inline = false;
+	} else {
+		pstr->buf = (char*) alloc_realloc(pstr->alloc, pstr->buf, pstr->capacity);
+	}
+}
+
+/*
+ * Make room for 'extra' more bytes, at least doubling the capacity so
+ * repeated growth stays amortized O(1) per byte.
+ */
+static inline void _str_grow_for(struct str* pstr, size_t extra) {
+	CHECK(extra <= INT_MAX - pstr->len, "str length overflow: %d + %zu bytes", pstr->len, extra);
+	int n = pstr->len + (int) extra;
+	if (n <= pstr->capacity) {
+		return;
+	}
+	int capacity = pstr->capacity == 0 ? 16 : pstr->capacity;
+	while (capacity < n) {
+		capacity = capacity > INT_MAX / 2 ? n : capacity << 1;
+	}
+	_str_set_capacity(pstr, capacity);
+}
+
 /*
  * Ensure there is enough space for at least one more byte.
  */
 static inline void _str_ensure_space(struct str* pstr) {
 	if (pstr->len == pstr->capacity) {
-		if (pstr->capacity == 0) {
-			pstr->capacity = 16;
-		} else {
-			pstr->capacity <<= 1;
-		}
-		pstr->buf = (char*) realloc(pstr->buf, pstr->capacity);
+		_str_grow_for(pstr, 1);
+	}
+}
+
+/*
+ * Make sure n bytes in total fit without reallocating.
+ */
+static inline void str_reserve(struct str* pstr, int n) {
+	if (n > pstr->capacity) {
+		_str_set_capacity(pstr, n);
 	}
 }
 
@@ -54,19 +139,101 @@ static inline void str_append(struct str* pstr, char ch) {
 
 static inline void str_free(struct str* pstr) {
   if (pstr->buf) {
-	  free(pstr->buf);
+    if (!pstr->buf_inline) {
+	    alloc_free(pstr->alloc, pstr->buf);
+    }
     pstr->buf = NULL;
   }
 }
 
-static inline int str_lenconcat(struct str* str, const char* extra, int n) {
-	int oldlen = str->len;
-  for (int i = 0; i < n; ++i) {
-    str_append(str, extra[i]);
-  }
+/*
+ * Append n bytes with a single memcpy and return the length before
+ * appending, i.e. the offset of the bytes.
+ */
+static inline int str_write_bytes(struct str* pstr, const void* data, size_t n) {
+	int oldlen = pstr->len;
+	_str_grow_for(pstr, n);
+	if (n > 0) {
+		memcpy(pstr->buf + pstr->len, data, n);
+	}
+	pstr->len += n;
+	return oldlen;
+}
+
+/*
+ * Append 'ch' n times with a single memset and return the length before
+ * appending.
+ */
+static inline int str_fill(struct str* pstr, size_t n, char ch) {
+	int oldlen = pstr->len;
+	_str_grow_for(pstr, n);
+	if (n > 0) {
+		memset(pstr->buf + pstr->len, ch, n);
+	}
+	pstr->len += n;
+	return oldlen;
+}
+
+/*
+ * Fixed width little-endian emitters, e.g. for immediates and ELF fields.
+ * Each returns the offset the value is written at.
+ */
+static inline int str_put_u8(struct str* pstr, uint8_t val) {
+	int oldlen = pstr->len;
+	str_append(pstr, (char) val);
+	return oldlen;
+}
+
+static inline int str_put_u16(struct str* pstr, uint16_t val) {
+	int oldlen = pstr->len;
+	_str_grow_for(pstr, 2);
+	uint8_t* p = (uint8_t*) pstr->buf + pstr->len;
+	p[0] = val;
+	p[1] = val >> 8;
+	pstr->len += 2;
+	return oldlen;
+}
+
+static inline int str_put_u32(struct str* pstr, uint32_t val) {
+	int oldlen = pstr->len;
+	_str_grow_for(pstr, 4);
+	uint8_t* p = (uint8_t*) pstr->buf + pstr->len;
+	p[0] = val;
+	p[1] = val >> 8;
+	p[2] = val >> 16;
+	p[3] = val >> 24;
+	pstr->len += 4;
+	return oldlen;
+}
+
+/*
+ * Append printf style formatted text and return the length before
+ * appending. The text is formatted straight into the buffer; the '\0'
+ * vsnprintf writes after it is not counted in len.
+ */
+__attribute__((format(printf, 2, 3)))
+static inline int str_appendf(struct str* pstr, const char* fmt, ...) {
+	int oldlen = pstr->len;
+	va_list ap;
+	va_start(ap, fmt);
+	int n = vsnprintf(pstr->buf + pstr->len, pstr->capacity - pstr->len, fmt, ap);
+	va_end(ap);
+	CHECK(n >= 0, "str_appendf: bad format '%s'", fmt);
+	if (n >= pstr->capacity - pstr->len) {
+		// didn't fit: grow and format again
+		_str_grow_for(pstr, (size_t) n + 1);
+		va_start(ap, fmt);
+		vsnprintf(pstr->buf + pstr->len, pstr->capacity - pstr->len, fmt, ap);
+		va_end(ap);
+	}
+	pstr->len += n;
 	return oldlen;
 }
 
+static inline int str_lenconcat(struct str* str, const char* extra, int n) {
+	return str_write_bytes(str, extra, n);
+}
+
 /*
  * Concat an cstr (with training '\0') and return the length before
  * concating.
@@ -86,14 +253,15 @@ static inline int str_concat(struct str* str, const char* extra) {
  * Append a character 'n' times.
  */
 static inline void str_nappend(struct str* pstr, int n, char ch) {
-  for (int i = 0; i < n; ++i) {
-    str_append(pstr, ch);
-  }
+  str_fill(pstr, n, ch);
 }
 
 /*
  * Implement a move semantic to release the ownership of the buffer
  * from 'pstr' and assign the ownership to the returned 'struct str'.
+ *
+ * An inline buffer is not copied, so the result still uses the storage given
+ * to str_create_inline.
  */
 static struct str str_move(struct str* pstr) {
   struct str ret = *pstr;
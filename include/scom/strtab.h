@@ -0,0 +1,142 @@
+#pragma once
+
+/*
+ * Build the content of a string table section like .strtab or .shstrtab.
+ *
+ * Strings are added first and get an ID (interned, so a duplicate gets the
+ * ID of the first copy). strtab_finalize then lays out the section with tail
+ * merging, like ld does for SHF_MERGE|SHF_STRINGS: a string that is a suffix
+ * of another one is not emitted but points into it, e.g. "name" is stored
+ * as part of "sh_name". Offsets are only known after finalizing, so callers
+ * keep the IDs and put the offsets into the sh_name/st_name fields of the
+ * headers they output.
+ *
+ * Finalizing sorts the strings by their reversed bytes, which puts a string
+ * right after the longer strings ending with it, so one pass comparing each
+ * string with the previously emitted one finds all suffixes. O(n log n).
+ *
+ * The empty string is always at offset 0.
+ */
+
+#include <stdint.h>
+#include <string.h>
+#include "scom/str.h"
+#include "scom/vec.h"
+#include "scom/intern.h"
+
+struct strtab {
+	struct intern names; // ID -> string
+	bool finalized;
+	struct str buf; // the section content after finalizing
+	struct vec offsets; // uint32_t. ID -> offset in buf after finalizing.
+};
+
+struct _strtab_entry {
+	const char* s;
+	uint32_t len;
+	uint32_t id;
+};
+
+static struct strtab strtab_create() {
+	struct strtab st;
+	st.names = intern_create();
+	st.finalized = false;
+	st.buf = str_create(0);
+	st.offsets = vec_create(sizeof(uint32_t));
+	return st;
+}
+
+static void strtab_free(struct strtab* st) {
+	intern_free(&st->names);
+	str_free(&st->buf);
+	vec_free(&st->offsets);
+}
+
+/*
+ * Add the first 'len' bytes of 's', which must not contain '\0', and return
+ * its ID.
+ */
+static uint32_t strtab_lenadd(struct strtab* st, const char* s, int len) {
+	assert(!st->finalized);
+	return intern_lenstr(&st->names, s, len);
+}
+
+static uint32_t strtab_add(struct strtab* st, const char* s) {
+	return strtab_lenadd(st, s, strlen(s));
+}
+
+/*
+ * Order by the reversed bytes. A string sorts before the strings it is a
+ * suffix of.
+ */
+static int _strtab_cmp_reversed(const void* _lhs, const void* _rhs) {
+	const struct _strtab_entry* lhs = (const struct _strtab_entry*) _lhs;
+	const struct _strtab_entry* rhs = (const struct _strtab_entry*) _rhs;
+	const uint8_t* l = (const uint8_t*) lhs->s + lhs->len;
+	const uint8_t* r = (const uint8_t*) rhs->s + rhs->len;
+	uint32_t n = lhs->len < rhs->len ? lhs->len : rhs->len;
+	for (uint32_t i = 0; i < n; ++i) {
+		--l;
+		--r;
+		if (*l != *r) {
+			return (int) *l - (int) *r;
+		}
+	}
+	return lhs->len < rhs->len ? -1 : lhs->len > rhs->len;
+}
+
+/*
+ * Lay out the section. No strings can be added afterwards.
+ */
+static void strtab_finalize(struct strtab* st) {
+	assert(!st->finalized);
+	st->finalized = true;
+	int n = intern_size(&st->names);
+	struct _strtab_entry* entries = (struct _strtab_entry*) malloc(sizeof(struct _strtab_entry) * (n > 0 ? n : 1));
+	size_t total = 1;
+	for (int i = 0; i < n; ++i) {
+		entries[i].s = intern_get(&st->names, i);
+		entries[i].len = strlen(entries[i].s);
+		entries[i].id = i;
+		total += entries[i].len + 1;
+	}
+	qsort(entries, n, sizeof(struct _strtab_entry), _strtab_cmp_reversed);
+
+	// worst case nothing is merged
+	str_reserve(&st->buf, total);
+	str_append(&st->buf, '\0');
+	vec_resize(&st->offsets, n);
+	uint32_t* offsets = (uint32_t*) st->offsets.data;
+	// walk from the end so the longest string of a suffix chain comes first
+	struct _strtab_entry* prev = NULL;
+	uint32_t prev_off = 0;
+	for (int i = n - 1; i >= 0; --i) {
+		struct _strtab_entry* cur = &entries[i];
+		if (cur->len == 0) {
+			offsets[cur->id] = 0;
+		} else if (prev && prev->len >= cur->len && memcmp(prev->s + prev->len - cur->len, cur->s, cur->len) == 0) {
+			offsets[cur->id] = prev_off + prev->len - cur->len;
+		} else {
+			prev = cur;
+			prev_off = str_write_bytes(&st->buf, cur->s, cur->len + 1);
+			offsets[cur->id] = prev_off;
+		}
+	}
+	free(entries);
+}
+
+/*
+ * Offset of the string with the ID in the finalized section.
+ */
+static uint32_t strtab_offset(struct strtab* st, uint32_t id) {
+	assert(st->finalized);
+	return *(uint32_t*) vec_get_item(&st->offsets, id);
+}
+
+/*
+ * Size in bytes of the finalized section.
+ */
+static int strtab_size(struct strtab* st) {
+	assert(st->finalized);
+	return st->buf.len;
+}
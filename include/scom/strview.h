@@ -0,0 +1,75 @@
+#pragma once
+
+/*
+ * A non-owning view of 'len' bytes at 'ptr'. The bytes are not necessarily
+ * '\0' terminated and must outlive the view.
+ *
+ * The functions below use the known length instead of scanning for '\0', so
+ * a name whose length was computed once (e.g. elfr_get_symname) can be
+ * compared, hashed and looked up any number of times without strlen.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include "scom/hash.h"
+
+struct strview {
+	const char *ptr;
+	size_t len;
+};
+
+static inline struct strview strview_create(const char *ptr, size_t len) {
+	struct strview view;
+	view.ptr = ptr;
+	view.len = len;
+	return view;
+}
+
+static inline struct strview strview_from_cstr(const char *cstr) {
+	return strview_create(cstr, strlen(cstr));
+}
+
+/*
+ * Reads at most view.len + 1 bytes of cstr, however long it is.
+ */
+static inline int strview_eq_cstr(struct strview view, const char *cstr) {
+	size_t n = strnlen(cstr, view.len + 1);
+	return n == view.len && memcmp(cstr, view.ptr, n) == 0;
+}
+
+static inline int strview_eq(struct strview lhs, struct strview rhs) {
+	return lhs.len == rhs.len && memcmp(lhs.ptr, rhs.ptr, lhs.len) == 0;
+}
+
+/*
+ * Byte-wise order like strcmp. A prefix sorts before the longer string.
+ */
+static inline int strview_cmp(struct strview lhs, struct strview rhs) {
+	size_t n = lhs.len < rhs.len ? lhs.len : rhs.len;
+	int r = memcmp(lhs.ptr, rhs.ptr, n);
+	if (r != 0) {
+		return r;
+	}
+	return lhs.len < rhs.len ? -1 : lhs.len > rhs.len;
+}
+
+static inline int strview_startswith(struct strview view, struct strview prefix) {
+	return view.len >= prefix.len && memcmp(view.ptr, prefix.ptr, prefix.len) == 0;
+}
+
+static inline int strview_endswith(struct strview view, struct strview suffix) {
+	return view.len >= suffix.len && memcmp(view.ptr + view.len - suffix.len, suffix.ptr, suffix.len) == 0;
+}
+
+/*
+ * Same value as str_hash_seeded_fn/str_hash_fn in dict.h for the same bytes,
+ * so a view can be looked up in a dict keyed by C strings.
+ */
+static inline uint32_t strview_hash_seeded(struct strview view, uint64_t seed) {
+	return _hash_fold32(hash_bytes(view.ptr, view.len, seed));
+}
+
+static inline uint32_t strview_hash(struct strview view) {
+	return strview_hash_seeded(view, 0);
+}
@@ -0,0 +1,337 @@
+#pragma once
+
+/*
+ * A fixed set of worker threads for data parallel loops, e.g. extracting the
+ * symbols of each input file.
+ *
+ *   struct threadpool *pool = threadpool_create(0); // one thread per core
+ *   parallel_for(pool, &files, scan_file, ctx, 1);
+ *   threadpool_free(pool);
+ *
+ * Each worker owns a work-stealing deque (Chase-Lev) of index ranges. A
+ * worker pops from the bottom of its own deque and, when that is empty,
+ * steals from the top of a random victim. A range bigger than the grain is
+ * split in half before running: the upper half is pushed for others to steal
+ * and the lower half is split further, so idle workers pick up big chunks
+ * and the owner works through cache-friendly small ones.
+ *
+ * The thread calling parallel_for takes part as worker 0 and returns once the
+ * whole range is done. Workers sleep while no loop is running.
+ *
+ * Limits: one loop at a time (calls from several threads are serialized) and
+ * no nested parallel_for from inside a loop body.
+ */
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <assert.h>
+#include <sched.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "scom/check.h"
+#include "scom/vec.h"
+
+#define TP_CACHE_LINE 64
+// ranges a deque holds. Splitting only needs about log2(n / grain) of them;
+// a range that does not fit is run without splitting further.
+#define TP_DEQUE_SIZE 256
+
+typedef void (*tp_range_fn)(void *ctx, size_t begin, size_t end);
+
+/*
+ * The fields are read and written with atomics since a thief may read a slot
+ * while the owner reuses it. The thief drops what it read in that case.
+ */
+struct tp_task {
+	size_t begin;
+	size_t end;
+};
+
+struct tp_deque {
+	int64_t top; // next slot to steal
+	int64_t bottom; // next slot to push
+	struct tp_task tasks[TP_DEQUE_SIZE];
+} __attribute__((aligned(TP_CACHE_LINE)));
+
+struct threadpool;
+
+struct tp_worker {
+	struct tp_deque deque;
+	struct threadpool *pool;
+	int id;
+	uint64_t rnd; // picks steal victims
+	pthread_t thread;
+} __attribute__((aligned(TP_CACHE_LINE)));
+
+struct threadpool {
+	int nworker; // including the caller of parallel_for as worker 0
+	struct tp_worker *workers;
+
+	// serializes loops
+	pthread_mutex_t run_lock;
+
+	// workers sleep on 'wake' until 'generation' moves on to a new loop
+	pthread_mutex_t lock;
+	pthread_cond_t wake;
+	uint64_t generation;
+	int stop;
+
+	// the current loop
+	tp_range_fn fn;
+	void *ctx;
+	size_t grain;
+	size_t nleft; // items not run yet
+};
+
+static bool _tp_push(struct tp_deque *deque, size_t begin, size_t end) {
+	int64_t b = __atomic_load_n(&deque->bottom, __ATOMIC_RELAXED);
+	int64_t t = __atomic_load_n(&deque->top, __ATOMIC_ACQUIRE);
+	if (b - t >= TP_DEQUE_SIZE) {
+		return false;
+	}
+	struct tp_task *task = &deque->tasks[b % TP_DEQUE_SIZE];
+	__atomic_store_n(&task->begin, begin, __ATOMIC_RELAXED);
+	__atomic_store_n(&task->end, end, __ATOMIC_RELAXED);
+	__atomic_store_n(&deque->bottom, b + 1, __ATOMIC_RELEASE);
+	return true;
+}
+
+static inline void _tp_load_task(struct tp_deque *deque, int64_t idx, struct tp_task *out) {
+	struct tp_task *task = &deque->tasks[idx % TP_DEQUE_SIZE];
+	out->begin = __atomic_load_n(&task->begin, __ATOMIC_RELAXED);
+	out->end = __atomic_load_n(&task->end, __ATOMIC_RELAXED);
+}
+
+/*
+ * Owner only. Take the most recently pushed range.
+ */
+static bool _tp_pop(struct tp_deque *deque, struct tp_task *out) {
+	int64_t b = __atomic_load_n(&deque->bottom, __ATOMIC_RELAXED) - 1;
+	__atomic_store_n(&deque->bottom, b, __ATOMIC_SEQ_CST);
+	int64_t t = __atomic_load_n(&deque->top, __ATOMIC_SEQ_CST);
+	if (t > b) {
+		// empty
+		__atomic_store_n(&deque->bottom, b + 1, __ATOMIC_RELAXED);
+		return false;
+	}
+	_tp_load_task(deque, b, out);
+	if (t < b) {
+		return true;
+	}
+	// the last range: race with thieves for it
+	bool won = __atomic_compare_exchange_n(&deque->top, &t, t + 1, false, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED);
+	__atomic_store_n(&deque->bottom, b + 1, __ATOMIC_RELAXED);
+	return won;
+}
+
+/*
+ * Any thread. Take the oldest (and so biggest) range.
+ */
+static bool _tp_steal(struct tp_deque *deque, struct tp_task *out) {
+	int64_t t = __atomic_load_n(&deque->top, __ATOMIC_SEQ_CST);
+	int64_t b = __atomic_load_n(&deque->bottom, __ATOMIC_SEQ_CST);
+	if (t >= b) {
+		return false;
+	}
+	_tp_load_task(deque, t, out);
+	return __atomic_compare_exchange_n(&deque->top, &t, t + 1, false, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED);
+}
+
+/*
+ * Split the range down to the grain, leaving the upper halves to thieves,
+ * then run what is left.
+ */
+static void _tp_run(struct tp_worker *worker, struct tp_task task) {
+	struct threadpool *pool = worker->pool;
+	while (task.end - task.begin > pool->grain) {
+		size_t mid = task.begin + (task.end - task.begin) / 2;
+		if (!_tp_push(&worker->deque, mid, task.end)) {
+			break;
+		}
+		task.end = mid;
+	}
+	pool->fn(pool->ctx, task.begin, task.end);
+	__atomic_sub_fetch(&pool->nleft, task.end - task.begin, __ATOMIC_RELEASE);
+}
+
+/*
+ * Run one range from the own deque or a victim's. Return false if none was
+ * found.
+ */
+static bool _tp_work_once(struct tp_worker *worker) {
+	struct threadpool *pool = worker->pool;
+	struct tp_task task;
+	if (_tp_pop(&worker->deque, &task)) {
+		_tp_run(worker, task);
+		return true;
+	}
+	if (pool->nworker == 1) {
+		return false;
+	}
+	// xorshift
+	uint64_t x = worker->rnd;
+	x ^= x << 13;
+	x ^= x >> 7;
+	x ^= x << 17;
+	worker->rnd = x;
+	int victim = x % (pool->nworker - 1);
+	victim += victim >= worker->id;
+	if (_tp_steal(&pool->workers[victim].deque, &task)) {
+		_tp_run(worker, task);
+		return true;
+	}
+	return false;
+}
+
+static void *_tp_worker_main(void *arg) {
+	struct tp_worker *worker = (struct tp_worker*) arg;
+	struct threadpool *pool = worker->pool;
+	uint64_t seen = 0;
+	while (true) {
+		pthread_mutex_lock(&pool->lock);
+		while (pool->generation == seen && !pool->stop) {
+			pthread_cond_wait(&pool->wake, &pool->lock);
+		}
+		int stop = pool->stop;
+		seen = pool->generation;
+		pthread_mutex_unlock(&pool->lock);
+		if (stop) {
+			return NULL;
+		}
+		while (__atomic_load_n(&pool->nleft, __ATOMIC_ACQUIRE) > 0) {
+			if (!_tp_work_once(worker)) {
+				sched_yield();
+			}
+		}
+	}
+}
+
+/*
+ * nthread includes the thread calling parallel_for. 0 means one per online
+ * core.
+ */
+static struct threadpool *threadpool_create(int nthread) {
+	if (nthread <= 0) {
+		nthread = (int) sysconf(_SC_NPROCESSORS_ONLN);
+		if (nthread <= 0) {
+			nthread = 1;
+		}
+	}
+	struct threadpool *pool = (struct threadpool*) calloc(1, sizeof(struct threadpool));
+	CHECK(pool, "fail to allocate the thread pool");
+	pool->nworker = nthread;
+	CHECK(posix_memalign((void**) &pool->workers, TP_CACHE_LINE, sizeof(struct tp_worker) * nthread) == 0, "fail to allocate %d workers", nthread);
+	memset(pool->workers, 0, sizeof(struct tp_worker) * nthread);
+	pthread_mutex_init(&pool->run_lock, NULL);
+	pthread_mutex_init(&pool->lock, NULL);
+	pthread_cond_init(&pool->wake, NULL);
+	for (int i = 0; i < nthread; ++i) {
+		struct tp_worker *worker = &pool->workers[i];
+		worker->pool = pool;
+		worker->id = i;
+		worker->rnd = 0x9E3779B97F4A7C15ULL * (i + 1);
+		if (i > 0) {
+			CHECK(pthread_create(&worker->thread, NULL, _tp_worker_main, worker) == 0, "fail to create worker thread %d", i);
+		}
+	}
+	return pool;
+}
+
+static void threadpool_free(struct threadpool *pool) {
+	pthread_mutex_lock(&pool->lock);
+	pool->stop = 1;
+	pthread_cond_broadcast(&pool->wake);
+	pthread_mutex_unlock(&pool->lock);
+	for (int i = 1; i < pool->nworker; ++i) {
+		pthread_join(pool->workers[i].thread, NULL);
+	}
+	pthread_cond_destroy(&pool->wake);
+	pthread_mutex_destroy(&pool->lock);
+	pthread_mutex_destroy(&pool->run_lock);
+	free(pool->workers);
+	free(pool);
+}
+
+/*
+ * Call fn(ctx, begin, end) on disjoint ranges covering [0, n) in parallel.
+ * Ranges have at most 'grain' items (0 picks one giving each worker about 8
+ * ranges). Return once all are done.
+ */
+static void threadpool_run(struct threadpool *pool, size_t n, tp_range_fn fn, void *ctx, size_t grain) {
+	if (n == 0) {
+		return;
+	}
+	if (grain == 0) {
+		grain = n / (8 * pool->nworker);
+		grain = grain > 0 ? grain : 1;
+	}
+	pthread_mutex_lock(&pool->run_lock);
+	pool->fn = fn;
+	pool->ctx = ctx;
+	pool->grain = grain;
+	__atomic_store_n(&pool->nleft, n, __ATOMIC_RELEASE);
+	struct tp_worker *self = &pool->workers[0];
+	bool pushed = _tp_push(&self->deque, 0, n);
+	assert(pushed);
+
+	pthread_mutex_lock(&pool->lock);
+	++pool->generation;
+	pthread_cond_broadcast(&pool->wake);
+	pthread_mutex_unlock(&pool->lock);
+
+	while (__atomic_load_n(&pool->nleft, __ATOMIC_ACQUIRE) > 0) {
+		if (!_tp_work_once(self)) {
+			sched_yield();
+		}
+	}
+	pthread_mutex_unlock(&pool->run_lock);
+}
+
+typedef void (*parallel_for_fn)(void *ctx, void *item, size_t idx);
+typedef void (*parallel_map_fn)(void *ctx, const void *in, void *out, size_t idx);
+
+struct _tp_vec_loop {
+	struct vec *in;
+	struct vec *out;
+	void *fn;
+	void *ctx;
+};
+
+static void _tp_for_range(void *arg, size_t begin, size_t end) {
+	struct _tp_vec_loop *loop = (struct _tp_vec_loop*) arg;
+	parallel_for_fn fn = (parallel_for_fn) loop->fn;
+	char *item = (char*) loop->in->data + begin * loop->in->itemsize;
+	for (size_t i = begin; i < end; ++i, item += loop->in->itemsize) {
+		fn(loop->ctx, item, i);
+	}
+}
+
+static void _tp_map_range(void *arg, size_t begin, size_t end) {
+	struct _tp_vec_loop *loop = (struct _tp_vec_loop*) arg;
+	parallel_map_fn fn = (parallel_map_fn) loop->fn;
+	for (size_t i = begin; i < end; ++i) {
+		fn(loop->ctx, (char*) loop->in->data + i * loop->in->itemsize, (char*) loop->out->data + i * loop->out->itemsize, i);
+	}
+}
+
+/*
+ * Call fn(ctx, item_ptr, idx) for every item of vec in parallel, in chunks
+ * of up to 'grain' items (0 to pick one). The vec must not be resized
+ * meanwhile.
+ */
+static void parallel_for(struct threadpool *pool, struct vec *vec, parallel_for_fn fn, void *ctx, size_t grain) {
+	struct _tp_vec_loop loop = {vec, NULL, (void*) fn, ctx};
+	threadpool_run(pool, vec->len, _tp_for_range, &loop, grain);
+}
+
+/*
+ * Resize 'out' to in->len items (zero filled) and call
+ * fn(ctx, in_item_ptr, out_item_ptr, idx) for each index in parallel.
+ */
+static void parallel_map(struct threadpool *pool, struct vec *in, struct vec *out, parallel_map_fn fn, void *ctx, size_t grain) {
+	assert(in != out);
+	vec_resize(out, in->len);
+	struct _tp_vec_loop loop = {in, out, (void*) fn, ctx};
+	threadpool_run(pool, in->len, _tp_map_range, &loop, grain);
+}
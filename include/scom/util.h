@@ -3,6 +3,7 @@
 #include <assert.h>
 #include <stdint.h>
 #include <string.h>
+#include "scom/alloc.h"
 
 #define bool int
 #define true 1
@@ -21,8 +22,13 @@ static uint32_t endian_swap(uint32_t val) {
 }
 
 static int startswith(const char* s, const char* t) {
-  int len = strlen(t);
-  return strncmp(s, t, len) == 0;
+  // one pass over the prefix instead of strlen followed by strncmp
+  for (; *t; ++s, ++t) {
+    if (*s != *t) {
+      return 0;
+    }
+  }
+  return 1;
 }
 
 static int endswith(const char* s, const char* t) {
@@ -33,9 +39,5 @@ static int endswith(const char* s, const char* t) {
 }
 
 static char* lenstrdup(const char* src, int len) {
-  char* dst = (char*) malloc(len + 1);
-  assert(dst != NULL);
-  memcpy(dst, src, len);
-  dst[len] = '\0';
-  return dst;
+  return alloc_lenstrdup(NULL, src, len);
 }
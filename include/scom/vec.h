@@ -2,14 +2,17 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdint.h>
 #include <string.h>
 #include <ctype.h>
 #include "scom/check.h"
 #include "scom/util.h"
+#include "scom/alloc.h"
+#include "scom/strview.h"
 
 #define VEC_FOREACH_I(vec_ptr, item_type, item_ptr, i) \
   item_type* item_ptr = NULL; \
-  for (int i = 0; i < (vec_ptr)->len && (item_ptr = vec_get_item(vec_ptr, i)); ++i)
+  for (size_t i = 0; i < (vec_ptr)->len && (item_ptr = vec_get_item(vec_ptr, i)); ++i)
 
 // TODO: can we generate a unique name for the iterator variable
 // automatically.
@@ -17,16 +20,23 @@
 
 struct vec {
   int itemsize;
-  int capacity; // in number of item
-  int len; // in number of item
+  size_t capacity; // in number of item
+  size_t len; // in number of item
   void *data;
 
   // whether the destructor should free each item
   bool should_free_each_item;
+
+  // data points to storage provided to vec_create_inline rather than heap
+  // memory. Growing past it moves the items to the heap.
+  bool data_inline;
+
+  // where data (and owned items) come from. NULL for libc.
+  struct allocator* alloc;
 };
 
 static inline void vec_append(struct vec* vec, void *itemptr);
-static inline void* vec_get_item(struct vec* vec, int idx);
+static inline void* vec_get_item(struct vec* vec, size_t idx);
 
 /*
  * Make sure we don't malloc in this function so there is
@@ -40,16 +50,50 @@ static inline struct vec vec_create(int itemsize) {
   vec.len = 0;
 	vec.data = NULL;
   vec.should_free_each_item = false;
+  vec.data_inline = false;
+  vec.alloc = NULL;
+  return vec;
+}
+
+/*
+ * Same as vec_create but take memory from 'alloc'. If should_free_each_item
+ * is set, the items are released with 'alloc' too.
+ */
+static inline struct vec vec_create_with_alloc(int itemsize, struct allocator* alloc) {
+  struct vec vec = vec_create(itemsize);
+  vec.alloc = alloc;
+  return vec;
+}
+
+/*
+ * Create a vec that keeps up to 'n' items in 'storage' and only allocates
+ * once it grows past that. The storage must outlive the vec (or at least
+ * its use of the storage), e.g. a local array in the same scope:
+ *
+ *   char *buf[16];
+ *   struct vec names = VEC_CREATE_INLINE(sizeof(char*), buf);
+ *
+ * Everything else, including vec_free, works the same as for vec_create.
+ */
+static inline struct vec vec_create_inline(int itemsize, void *storage, size_t n) {
+  struct vec vec = vec_create(itemsize);
+  vec.data = storage;
+  vec.capacity = n;
+  vec.data_inline = true;
   return vec;
 }
 
+#define VEC_CREATE_INLINE(itemsize, storage) vec_create_inline(itemsize, storage, sizeof(storage) / (itemsize))
+
 // spaces preceding items with be ignored. But spaces inside or after items will be
 // kept.
 //
 // The vec_free function will free the memory allocated for each item automatically
 // since the vec.should_free_each_item flag is set to true here.
-static inline struct vec vec_create_from_csv(const char* csv) {
-  struct vec list = vec_create(sizeof(char*));
+//
+// The list and the items are taken from 'alloc' (NULL for libc).
+static inline struct vec vec_create_from_csv_with_alloc(const char* csv, struct allocator* alloc) {
+  struct vec list = vec_create_with_alloc(sizeof(char*), alloc);
   list.should_free_each_item = true;
 
   const char *l = csv, *r;
@@ -65,7 +109,7 @@ static inline struct vec vec_create_from_csv(const char* csv) {
       ++r;
     }
     if (r - l > 0) {
-      char* item = lenstrdup(l, r - l);
+      char* item = alloc_lenstrdup(alloc, l, r - l);
       vec_append(&list, &item);
     }
     l = r;
@@ -76,6 +120,10 @@ static inline struct vec vec_create_from_csv(const char* csv) {
   return list;
 }
 
+static inline struct vec vec_create_from_csv(const char* csv) {
+  return vec_create_from_csv_with_alloc(csv, NULL);
+}
+
 static inline void vec_free(struct vec* vec) {
   if (vec->data) {
     if (vec->should_free_each_item) {
@@ -84,29 +132,158 @@ static inline void vec_free(struct vec* vec) {
       // (e.g. char*) up-front.
       assert(vec->itemsize == sizeof(void*));
       VEC_FOREACH(vec, void*, item_ptr) {
-        free(*item_ptr);
+        alloc_free(vec->alloc, *item_ptr);
       }
     }
-    free(vec->data);
+    if (!vec->data_inline) {
+      alloc_free(vec->alloc, vec->data);
+    }
   }
   vec->data = NULL;
 }
 
+/*
+ * Set the capacity to exactly 'capacity' items, which must be no less than
+ * len.
+ */
+static inline void _vec_set_capacity(struct vec* vec, size_t capacity) {
+  assert(capacity >= vec->len);
+  CHECK(capacity <= SIZE_MAX / vec->itemsize, "vec capacity overflow: %zu items", capacity);
+  vec->capacity = capacity;
+  if (vec->data_inline) {
+    // spill to the heap
+    void *data = alloc_malloc(vec->alloc, vec->capacity * vec->itemsize);
+    if (vec->len > 0) {
+      memcpy(data, vec->data, vec->len * vec->itemsize);
+    }
+    vec->data = data;
+    vec->data_inline = false;
+  } else {
+    vec->data = alloc_realloc(vec->alloc, vec->data, vec->capacity * vec->itemsize);
+  }
+}
+
+/*
+ * Make room for n items in total, at least doubling the capacity so
+ * repeated growth stays amortized O(1) per item.
+ */
+static inline void _vec_grow_for(struct vec* vec, size_t n) {
+  if (n <= vec->capacity) {
+    return;
+  }
+  size_t capacity = vec->capacity == 0 ? 16 : vec->capacity;
+  while (capacity < n) {
+    capacity = capacity > SIZE_MAX / 2 ? n : capacity << 1;
+  }
+  _vec_set_capacity(vec, capacity);
+}
+
+/*
+ * Make room for one more item.
+ */
+static inline void _vec_grow(struct vec* vec) {
+  _vec_grow_for(vec, vec->len + 1);
+}
+
+/*
+ * Make sure n items in total fit without reallocating.
+ */
+static inline void vec_reserve(struct vec* vec, size_t n) {
+  if (n > vec->capacity) {
+    _vec_set_capacity(vec, n);
+  }
+}
+
+/*
+ * Append n items stored contiguously at 'items' with a single memcpy.
+ */
+static inline void vec_extend(struct vec* vec, const void *items, size_t n) {
+  CHECK(n <= SIZE_MAX - vec->len, "vec length overflow");
+  _vec_grow_for(vec, vec->len + n);
+  if (n > 0) {
+    memcpy(vec->data + vec->len * vec->itemsize, items, n * vec->itemsize);
+  }
+  vec->len += n;
+}
+
+/*
+ * Free the items in [idx, idx + n) if the vec owns them.
+ */
+static inline void _vec_free_items(struct vec* vec, size_t idx, size_t n) {
+  if (vec->should_free_each_item) {
+    assert(vec->itemsize == sizeof(void*));
+    for (size_t i = idx; i < idx + n; ++i) {
+      alloc_free(vec->alloc, ((void**) vec->data)[i]);
+    }
+  }
+}
+
+/*
+ * Change the number of items to n. New items are zero filled. Items dropped
+ * by shrinking are freed if should_free_each_item is set.
+ */
+static inline void vec_resize(struct vec* vec, size_t n) {
+  if (n < vec->len) {
+    _vec_free_items(vec, n, vec->len - n);
+  } else if (n > vec->len) {
+    _vec_grow_for(vec, n);
+    memset(vec->data + vec->len * vec->itemsize, 0, (n - vec->len) * vec->itemsize);
+  }
+  vec->len = n;
+}
+
+/*
+ * Insert n items stored contiguously at 'items' before index idx
+ * (0 <= idx <= len). 'items' must not point into the vec itself.
+ */
+static inline void vec_insert_range(struct vec* vec, size_t idx, const void *items, size_t n) {
+  CHECK(idx <= vec->len, "vec index out of range: index %zu, size %zu", idx, vec->len);
+  CHECK(n <= SIZE_MAX - vec->len, "vec length overflow");
+  _vec_grow_for(vec, vec->len + n);
+  if (n > 0) {
+    memmove(vec->data + (idx + n) * vec->itemsize, vec->data + idx * vec->itemsize, (vec->len - idx) * vec->itemsize);
+    memcpy(vec->data + idx * vec->itemsize, items, n * vec->itemsize);
+  }
+  vec->len += n;
+}
+
+/*
+ * Remove the n items starting at index idx. The items are freed if
+ * should_free_each_item is set.
+ */
+static inline void vec_erase_range(struct vec* vec, size_t idx, size_t n) {
+  CHECK(idx <= vec->len && n <= vec->len - idx, "vec range out of range: index %zu, count %zu, size %zu", idx, n, vec->len);
+  _vec_free_items(vec, idx, n);
+  memmove(vec->data + idx * vec->itemsize, vec->data + (idx + n) * vec->itemsize, (vec->len - idx - n) * vec->itemsize);
+  vec->len -= n;
+}
+
+/*
+ * Release the unused capacity.
+ */
+static inline void vec_shrink_to_fit(struct vec* vec) {
+  if (vec->len == vec->capacity || vec->data_inline) {
+    return;
+  }
+  if (vec->len == 0) {
+    alloc_free(vec->alloc, vec->data);
+    vec->data = NULL;
+    vec->capacity = 0;
+    return;
+  }
+  _vec_set_capacity(vec, vec->len);
+}
+
 static inline void vec_append(struct vec* vec, void *itemptr) {
   if (vec->len == vec->capacity) {
-    if (vec->capacity == 0) {
-      vec->capacity = 16;
-    } else {
-      vec->capacity <<= 1;
-    }
-    vec->data = realloc(vec->data, vec->capacity * vec->itemsize);
+    _vec_grow(vec);
   }
   memcpy(vec->data + vec->len * vec->itemsize, itemptr, vec->itemsize);
   ++vec->len;
 }
 
-static inline void* vec_get_item(struct vec* vec, int idx) {
-  CHECK(idx >= 0 && idx < vec->len, "vec index out of range: index %d, size %d", idx, vec->len);
+static inline void* vec_get_item(struct vec* vec, size_t idx) {
+  CHECK(idx < vec->len, "vec index out of range: index %zu, size %zu", idx, vec->len);
   return vec->data + idx * vec->itemsize;
 }
 
@@ -132,3 +309,17 @@ static inline int vec_str_find(struct vec* vec, char* needle) {
   }
   return -1;
 }
+
+/*
+ * Same as vec_str_find for a vec of struct strview. Items with a different
+ * length are skipped without touching their bytes.
+ */
+static inline int vec_strview_find(struct vec* vec, struct strview needle) {
+  assert(vec->itemsize == sizeof(struct strview));
+  VEC_FOREACH_I(vec, struct strview, item_ptr, i) {
+    if (strview_eq(*item_ptr, needle)) {
+      return i;
+    }
+  }
+  return -1;
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+/*
+ * VEC_DEFINE(name, T) generates typed accessors for a struct vec holding
+ * items of type T:
+ *
+ *   typedef T name##_t;
+ *   struct vec name##_create();
+ *   void name##_push(struct vec *, T item);
+ *   T *name##_at(struct vec *, size_t idx);            // bounds checked unless NDEBUG
+ *   T *name##_at_unchecked(struct vec *, size_t idx);  // never checked
+ *   T *name##_data(struct vec *);
+ *   T name##_pop(struct vec *);
+ *
+ * The functions work on a plain struct vec, so a vec created by vec_create
+ * (sizeof(T)) can be passed to them and vice versa. Existing code can move
+ * to the typed functions one call site at a time.
+ *
+ * Compared with vec_append/vec_get_item the item size is a compile time
+ * constant: push is a plain assignment instead of a memcpy, and indexing
+ * needs no multiply by itemsize at runtime. Only name##_at checks the index,
+ * and with an assert instead of CHECK, so release builds pay nothing.
+ *
+ * Example:
+ *   VEC_DEFINE(int_vec, int)
+ *   struct vec v = int_vec_create();
+ *   int_vec_push(&v, 3);
+ *   VEC_DEFINE_FOREACH(int_vec, &v, item) {
+ *     printf("%d\n", *item);
+ *   }
+ *   vec_free(&v);
+ */
+
+#include <assert.h>
+#include "scom/vec.h"
+
+#define VEC_DEFINE_FOREACH(name, vec_ptr, item_ptr) \
+  for (name##_t *item_ptr = name##_data(vec_ptr), *item_ptr##_end = item_ptr + (vec_ptr)->len; \
+      item_ptr != item_ptr##_end; \
+      ++item_ptr)
+
+#define VEC_DEFINE(name, T) \
+typedef T name##_t; \
+\
+static inline struct vec name##_create() { \
+	return vec_create(sizeof(T)); \
+} \
+\
+static inline T *name##_data(struct vec *vec) { \
+	assert(vec->itemsize == sizeof(T)); \
+	return (T*) vec->data; \
+} \
+\
+static inline void name##_push(struct vec *vec, T item) { \
+	assert(vec->itemsize == sizeof(T)); \
+	if (vec->len == vec->capacity) { \
+		_vec_grow(vec); \
+	} \
+	((T*) vec->data)[vec->len++] = item; \
+} \
+\
+static inline T *name##_at_unchecked(struct vec *vec, size_t idx) { \
+	return (T*) vec->data + idx; \
+} \
+\
+static inline T *name##_at(struct vec *vec, size_t idx) { \
+	assert(vec->itemsize == sizeof(T)); \
+	assert(idx < vec->len); \
+	return (T*) vec->data + idx; \
+} \
+\
+static inline T name##_pop(struct vec *vec) { \
+	assert(vec->itemsize == sizeof(T)); \
+	assert(vec->len > 0); \
+	return ((T*) vec->data)[--vec->len]; \
+}
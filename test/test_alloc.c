@@ -0,0 +1,94 @@
+#include "scom/alloc.h"
+#include "scom/vec.h"
+#include "scom/str.h"
+#include "scom/dict.h"
+#include <assert.h>
+#include <stdio.h>
+
+void test_libc() {
+	char *p = (char*) alloc_calloc(NULL, 4, 4);
+	for (int i = 0; i < 16; ++i) {
+		assert(p[i] == 0);
+	}
+	p = (char*) alloc_realloc(NULL, p, 32);
+	alloc_free(NULL, p);
+	alloc_free(NULL, NULL);
+}
+
+void test_vec() {
+	struct counting_allocator ca;
+	counting_allocator_init(&ca, NULL);
+	struct vec vec = vec_create_with_alloc(sizeof(char*), &ca.base);
+	vec.should_free_each_item = true;
+	for (int i = 0; i < 100; ++i) {
+		char *item = alloc_lenstrdup(&ca.base, "item", 4);
+		vec_append(&vec, &item);
+	}
+	assert(strcmp(*(char**) vec_get_item(&vec, 99), "item") == 0);
+	// 100 items plus the growth of data
+	assert(ca.nalloc > 100);
+	vec_free(&vec);
+	assert(ca.nfree == 101);
+}
+
+void test_str() {
+	struct counting_allocator ca;
+	counting_allocator_init(&ca, NULL);
+	struct str s = str_create_with_alloc(4, &ca.base);
+	assert(ca.nalloc == 1 && ca.nbytes == 4);
+	str_concat(&s, "hello world");
+	assert(strcmp(s.buf, "hello world") == 0);
+	assert(ca.nalloc > 1);
+	str_free(&s);
+	assert(ca.nfree == 1);
+
+	// inline storage is not taken from the allocator
+	char storage[16];
+	counting_allocator_init(&ca, NULL);
+	s = STR_CREATE_INLINE(storage);
+	s.alloc = &ca.base;
+	str_concat(&s, "hello");
+	str_free(&s);
+	assert(ca.nalloc == 0 && ca.nfree == 0);
+}
+
+static void check_dict(int layout, bool incremental, struct counting_allocator* ca) {
+	counting_allocator_init(ca, NULL);
+	struct dict dict = dict_create_with_alloc(layout, str_hash_fn, str_eq_fn, true, false, &ca->base);
+	dict_set_incremental_rehash(&dict, incremental);
+	// the initial tables come from the allocator too
+	uint64_t nalloc = ca->nalloc;
+	assert(nalloc > 0);
+	char buf[16];
+	for (int i = 0; i < 1000; ++i) {
+		snprintf(buf, sizeof(buf), "%d", i);
+		dict_put(&dict, alloc_lenstrdup(&ca->base, buf, strlen(buf)), (void*) (intptr_t) i);
+	}
+	assert(ca->nalloc > nalloc + 1000); // keys and growth
+	for (int i = 0; i < 1000; i += 2) {
+		snprintf(buf, sizeof(buf), "%d", i);
+		assert(dict_remove(&dict, buf));
+	}
+	assert(dict.size == 500);
+	assert(dict_find(&dict, "999")->val == (void*) 999);
+	dict_free(&dict);
+	// the dict never reallocs, so every allocation is matched by a free
+	assert(ca->nfree == ca->nalloc);
+}
+
+void test_dict() {
+	struct counting_allocator ca;
+	check_dict(DICT_LINEAR, false, &ca);
+	check_dict(DICT_SWISS, false, &ca);
+	check_dict(DICT_COMPACT, false, &ca);
+	check_dict(DICT_LINEAR, true, &ca);
+}
+
+int main(void) {
+	test_libc();
+	test_vec();
+	test_str();
+	test_dict();
+	printf("PASS!\n");
+	return 0;
+}
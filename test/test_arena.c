@@ -0,0 +1,131 @@
+#include "scom/arena.h"
+#include "scom/vec.h"
+#include "scom/str.h"
+#include "scom/dict.h"
+#include <assert.h>
+#include <stdio.h>
+
+void test_no_malloc_in_init() {
+	struct arena arena;
+	arena_init(&arena, 0);
+	assert(arena.head == NULL && arena.nchunk == 0);
+	arena_release(&arena);
+}
+
+void test_alloc() {
+	struct arena arena;
+	arena_init(&arena, 64);
+	char *a = (char*) arena_alloc(&arena, 3);
+	char *b = (char*) arena_alloc(&arena, 5);
+	assert((uintptr_t) a % ARENA_DEFAULT_ALIGN == 0);
+	assert((uintptr_t) b % ARENA_DEFAULT_ALIGN == 0);
+	assert(b >= a + 3);
+	char *c = (char*) arena_alloc_aligned(&arena, 1, 64);
+	assert((uintptr_t) c % 64 == 0);
+	int *zeros = (int*) arena_calloc(&arena, 100, sizeof(int));
+	for (int i = 0; i < 100; ++i) {
+		assert(zeros[i] == 0);
+	}
+	// a request larger than the chunk size gets a chunk of its own
+	char *big = (char*) arena_alloc(&arena, 10000);
+	memset(big, 1, 10000);
+	assert(strcmp(arena_strdup(&arena, "hello"), "hello") == 0);
+	assert(strcmp(arena_lenstrdup(&arena, "hello", 4), "hell") == 0);
+	assert(arena.nchunk > 1);
+	arena_release(&arena);
+	assert(arena.head == NULL && arena.nchunk == 0);
+
+	// reusable after release
+	a = (char*) arena_alloc(&arena, 3);
+	assert(arena.nchunk == 1);
+	arena_release(&arena);
+}
+
+void test_mark_rewind() {
+	struct arena arena;
+	arena_init(&arena, 64);
+	char *keep = arena_strdup(&arena, "keep");
+	struct arena_mark mark = arena_mark(&arena);
+	int nchunk = arena.nchunk;
+	char *first = (char*) arena_alloc(&arena, 8);
+	for (int i = 0; i < 100; ++i) {
+		arena_alloc(&arena, 100);
+	}
+	assert(arena.nchunk > nchunk);
+	arena_rewind(&arena, mark);
+	assert(arena.nchunk == nchunk);
+	assert(strcmp(keep, "keep") == 0);
+	// the memory after the mark is handed out again
+	assert(arena_alloc(&arena, 8) == first);
+
+	// rewinding to a mark taken on an empty arena releases everything
+	arena_release(&arena);
+	mark = arena_mark(&arena);
+	arena_alloc(&arena, 8);
+	arena_rewind(&arena, mark);
+	assert(arena.nchunk == 0);
+}
+
+void test_containers() {
+	struct arena arena;
+	arena_init(&arena, 0);
+
+	struct vec vec = vec_create_with_alloc(sizeof(int), &arena.base);
+	for (int i = 0; i < 1000; ++i) {
+		vec_append(&vec, &i);
+	}
+	for (int i = 0; i < 1000; ++i) {
+		assert(*(int*) vec_get_item(&vec, i) == i);
+	}
+
+	struct vec csv = vec_create_from_csv_with_alloc("a, bb,ccc", &arena.base);
+	assert(csv.len == 3);
+	assert(strcmp(*(char**) vec_get_item(&csv, 2), "ccc") == 0);
+	// freeing is harmless
+	vec_free(&csv);
+
+	struct str s = str_create_with_alloc(0, &arena.base);
+	for (int i = 0; i < 100; ++i) {
+		str_concat(&s, "x");
+	}
+	assert(s.len == 200 && s.buf[198] == 'x');
+
+	struct dict dict = dict_create_with_alloc(DICT_LINEAR, str_hash_fn, str_eq_fn, true, false, &arena.base);
+	char buf[16];
+	for (int i = 0; i < 1000; ++i) {
+		snprintf(buf, sizeof(buf), "%d", i);
+		dict_put(&dict, arena_strdup(&arena, buf), (void*) (intptr_t) i);
+	}
+	for (int i = 0; i < 1000; ++i) {
+		snprintf(buf, sizeof(buf), "%d", i);
+		assert(dict_find(&dict, buf)->val == (void*) (intptr_t) i);
+	}
+
+	// no vec_free/str_free/dict_free needed
+	arena_release(&arena);
+}
+
+void test_realloc_in_place() {
+	struct arena arena;
+	arena_init(&arena, 0);
+	void *p = alloc_malloc(&arena.base, 16);
+	void *q = alloc_realloc(&arena.base, p, 64);
+	assert(p == q);
+	// not the last block any more, so it moves and keeps the content
+	memset(q, 7, 64);
+	alloc_malloc(&arena.base, 1);
+	char *r = (char*) alloc_realloc(&arena.base, q, 128);
+	assert(r != q && r[63] == 7);
+	alloc_free(&arena.base, r);
+	arena_release(&arena);
+}
+
+int main(void) {
+	test_no_malloc_in_init();
+	test_alloc();
+	test_mark_rewind();
+	test_containers();
+	test_realloc_in_place();
+	printf("PASS!\n");
+	return 0;
+}
@@ -0,0 +1,102 @@
+#include "scom/chunkbuf.h"
+#include <assert.h>
+#include <stdio.h>
+#include <fcntl.h>
+
+void test_no_malloc_in_creator() {
+	struct chunkbuf cb = chunkbuf_create(0);
+	assert(cb.blocks.data == NULL && cb.len == 0);
+	assert(cb.block_size == CHUNKBUF_DEFAULT_BLOCK_SIZE);
+}
+
+// the expected content: byte i is i % 251
+static void check_content(struct chunkbuf *cb, size_t n) {
+	assert(cb->len == n);
+	for (size_t i = 0; i < n; ++i) {
+		assert(*(uint8_t*) chunkbuf_at(cb, i) == i % 251);
+	}
+}
+
+void test_append_across_blocks() {
+	uint8_t data[1000];
+	for (int i = 0; i < 1000; ++i) {
+		data[i] = i % 251;
+	}
+	struct chunkbuf cb = chunkbuf_create(16);
+	assert(chunkbuf_append(&cb, data, 7) == 0);
+	assert(chunkbuf_append(&cb, data + 7, 0) == 7);
+	assert(chunkbuf_append(&cb, data + 7, 993) == 7);
+	check_content(&cb, 1000);
+	assert(cb.blocks.len == (1000 + 15) / 16);
+	// blocks are never moved
+	char *first = chunkbuf_at(&cb, 0);
+	chunkbuf_append(&cb, data, 1000);
+	assert(chunkbuf_at(&cb, 0) == first);
+	assert(chunkbuf_contiguous(&cb, 3) == 13);
+	assert(chunkbuf_contiguous(&cb, 1998) == 2);
+	chunkbuf_free(&cb);
+}
+
+void test_reserve_fill() {
+	struct chunkbuf cb = chunkbuf_create(16);
+	chunkbuf_reserve(&cb, 100);
+	assert(cb.blocks.len == 7 && cb.len == 0);
+	assert(chunkbuf_fill(&cb, 3, 'a') == 0);
+	assert(chunkbuf_fill(&cb, 40, 'b') == 3);
+	assert(cb.blocks.len == 7);
+	assert(*chunkbuf_at(&cb, 2) == 'a' && *chunkbuf_at(&cb, 3) == 'b' && *chunkbuf_at(&cb, 42) == 'b');
+	chunkbuf_free(&cb);
+}
+
+void test_patch_read() {
+	struct chunkbuf cb = chunkbuf_create(16);
+	chunkbuf_fill(&cb, 64, 0);
+	// straddles the blocks at 16 and 32
+	uint8_t data[30];
+	for (int i = 0; i < 30; ++i) {
+		data[i] = i + 1;
+	}
+	chunkbuf_patch(&cb, 10, data, 30);
+	uint8_t out[64];
+	chunkbuf_read(&cb, 0, out, 64);
+	for (int i = 0; i < 64; ++i) {
+		assert(out[i] == (i >= 10 && i < 40 ? i - 9 : 0));
+	}
+	uint32_t val = 0xdeadbeef;
+	chunkbuf_patch(&cb, 14, &val, 4);
+	uint32_t back;
+	chunkbuf_read(&cb, 14, &back, 4);
+	assert(back == 0xdeadbeef);
+	chunkbuf_free(&cb);
+}
+
+void test_writev() {
+	uint8_t data[5000];
+	for (int i = 0; i < 5000; ++i) {
+		data[i] = i % 251;
+	}
+	// more blocks than IOV_MAX
+	struct chunkbuf cb = chunkbuf_create(2);
+	chunkbuf_append(&cb, data, 5000);
+	const char *path = "/tmp/test_chunkbuf.bin";
+	int fd = open(path, O_CREAT | O_TRUNC | O_RDWR, 0644);
+	assert(fd >= 0);
+	assert(write(fd, "x", 1) == 1);
+	chunkbuf_writev(&cb, fd);
+	uint8_t back[5001];
+	assert(pread(fd, back, sizeof(back), 0) == sizeof(back));
+	assert(back[0] == 'x' && memcmp(back + 1, data, 5000) == 0);
+	close(fd);
+	unlink(path);
+	chunkbuf_free(&cb);
+}
+
+int main(void) {
+	test_no_malloc_in_creator();
+	test_append_across_blocks();
+	test_reserve_fill();
+	test_patch_read();
+	test_writev();
+	printf("PASS!\n");
+	return 0;
+}
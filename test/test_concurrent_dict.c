@@ -0,0 +1,162 @@
+#include "scom/concurrent_dict.h"
+#include <assert.h>
+#include <stdio.h>
+#include <pthread.h>
+
+void test_basic() {
+	struct cdict cd = cdict_create(str_hash_fn, str_eq_fn, 1, 2);
+	void *val = NULL;
+	assert(cdict_put(&cd, strdup("hello"), (void*) 2) == 1);
+	assert(cdict_put(&cd, strdup("world"), (void*) 3) == 1);
+	assert(cdict_put(&cd, strdup("hello"), (void*) 4) == 0);
+	assert(cdict_find(&cd, "hello", &val) && val == (void*) 4);
+	assert(cdict_put_if_absent(&cd, strdup("world"), (void*) 5, &val) == 0);
+	assert(val == (void*) 3);
+	assert(cdict_find(&cd, "world", &val) && val == (void*) 3);
+	assert(!cdict_find(&cd, "NOT_FOUND", NULL));
+	assert(cdict_size(&cd) == 2);
+
+	char buf[16];
+	for (int i = 0; i < 10000; ++i) {
+		snprintf(buf, sizeof(buf), "key%d", i);
+		assert(cdict_put(&cd, strdup(buf), (void*) (intptr_t) i) == 1);
+	}
+	for (int i = 0; i < 10000; ++i) {
+		snprintf(buf, sizeof(buf), "key%d", i);
+		assert(cdict_find(&cd, buf, &val) && val == (void*) (intptr_t) i);
+	}
+	cdict_free(&cd);
+}
+
+enum {
+	NTHREAD = 8,
+	NKEY = 20000,
+};
+
+static char *keys[NKEY];
+static struct cdict shared;
+static int nwin[NTHREAD];
+
+static void *racer(void *arg) {
+	intptr_t tid = (intptr_t) arg;
+	for (int i = 0; i < NKEY; ++i) {
+		// every thread walks the keys in a different order
+		int k = (i * 7919 + tid * 104729) % NKEY;
+		void *existing = NULL;
+		if (cdict_put_if_absent(&shared, keys[k], (void*) (tid + 1), &existing)) {
+			++nwin[tid];
+		} else {
+			assert(existing != NULL);
+		}
+		// whatever is found must be a value some thread put for this key
+		void *val = NULL;
+		assert(cdict_find(&shared, keys[(k + 1) % NKEY], &val) || val == NULL);
+		assert(cdict_find(&shared, keys[k], &val));
+		assert((intptr_t) val >= 1 && (intptr_t) val <= NTHREAD);
+	}
+	return NULL;
+}
+
+void test_first_definition_wins() {
+	char buf[16];
+	for (int i = 0; i < NKEY; ++i) {
+		snprintf(buf, sizeof(buf), "sym%d", i);
+		keys[i] = strdup(buf);
+	}
+	shared = cdict_create(str_hash_fn, str_eq_fn, 0, 4);
+	pthread_t threads[NTHREAD];
+	for (intptr_t t = 0; t < NTHREAD; ++t) {
+		pthread_create(&threads[t], NULL, racer, (void*) t);
+	}
+	for (int t = 0; t < NTHREAD; ++t) {
+		pthread_join(threads[t], NULL);
+	}
+	// exactly one thread won each key and the winner's value stuck
+	int total = 0;
+	for (int t = 0; t < NTHREAD; ++t) {
+		total += nwin[t];
+	}
+	assert(total == NKEY);
+	assert(cdict_size(&shared) == NKEY);
+	int won_by[NTHREAD] = {0};
+	for (int i = 0; i < NKEY; ++i) {
+		void *val = NULL;
+		assert(cdict_find(&shared, keys[i], &val));
+		++won_by[(intptr_t) val - 1];
+	}
+	for (int t = 0; t < NTHREAD; ++t) {
+		assert(won_by[t] == nwin[t]);
+	}
+	cdict_free(&shared);
+	for (int i = 0; i < NKEY; ++i) {
+		free(keys[i]);
+	}
+}
+
+static char *missing[NKEY];
+static int done_inserting;
+
+static void *inserter(void *arg) {
+	intptr_t tid = (intptr_t) arg;
+	for (int i = tid; i < NKEY; i += NTHREAD / 2) {
+		cdict_put(&shared, keys[i], (void*) (intptr_t) (i + 1));
+	}
+	return NULL;
+}
+
+static void *miss_reader(void *arg) {
+	intptr_t tid = (intptr_t) arg;
+	void *val;
+	do {
+		for (int i = tid; i < NKEY; i += NTHREAD / 2) {
+			// the slot a missing key's probe stops at may be filled by another
+			// key right then. That must still be a miss.
+			assert(!cdict_find(&shared, missing[i], &val));
+		}
+	} while (!__atomic_load_n(&done_inserting, __ATOMIC_ACQUIRE));
+	return NULL;
+}
+
+void test_miss_during_insert() {
+	char buf[16];
+	for (int i = 0; i < NKEY; ++i) {
+		snprintf(buf, sizeof(buf), "sym%d", i);
+		keys[i] = strdup(buf);
+		snprintf(buf, sizeof(buf), "missing%d", i);
+		missing[i] = strdup(buf);
+	}
+	// a single shard so every lookup races with every insert
+	shared = cdict_create(str_hash_fn, str_eq_fn, 0, 0);
+	done_inserting = 0;
+	pthread_t threads[NTHREAD];
+	for (intptr_t t = 0; t < NTHREAD / 2; ++t) {
+		pthread_create(&threads[t], NULL, inserter, (void*) t);
+		pthread_create(&threads[NTHREAD / 2 + t], NULL, miss_reader, (void*) t);
+	}
+	for (int t = 0; t < NTHREAD / 2; ++t) {
+		pthread_join(threads[t], NULL);
+	}
+	__atomic_store_n(&done_inserting, 1, __ATOMIC_RELEASE);
+	for (int t = NTHREAD / 2; t < NTHREAD; ++t) {
+		pthread_join(threads[t], NULL);
+	}
+	assert(cdict_size(&shared) == NKEY);
+	for (int i = 0; i < NKEY; ++i) {
+		void *val = NULL;
+		assert(cdict_find(&shared, keys[i], &val) && val == (void*) (intptr_t) (i + 1));
+		assert(!cdict_find(&shared, missing[i], NULL));
+	}
+	cdict_free(&shared);
+	for (int i = 0; i < NKEY; ++i) {
+		free(keys[i]);
+		free(missing[i]);
+	}
+}
+
+int main(void) {
+	test_basic();
+	test_first_definition_wins();
+	test_miss_during_insert();
+	printf("PASS!\n");
+	return 0;
+}
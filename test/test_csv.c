@@ -0,0 +1,101 @@
+#include "scom/csv.h"
+#include <assert.h>
+#include <stdio.h>
+
+static struct strview view_at(struct vec *views, int i) {
+	return *(struct strview*) vec_get_item(views, i);
+}
+
+void test_split() {
+	const char *csv = "  hello,world , ,,a b,";
+	struct vec views = vec_create_views_from_csv(csv);
+	assert(views.len == 3);
+	assert(strview_eq_cstr(view_at(&views, 0), "hello"));
+	assert(strview_eq_cstr(view_at(&views, 1), "world "));
+	assert(strview_eq_cstr(view_at(&views, 2), "a b"));
+	// no copies
+	assert(view_at(&views, 0).ptr == csv + 2);
+	vec_free(&views);
+
+	views = vec_create_views_from_csv("");
+	assert(views.len == 0);
+	vec_free(&views);
+}
+
+static void check_same_as_vec_create_from_csv(const char *csv) {
+	struct vec expected = vec_create_from_csv(csv);
+	struct vec views = vec_create_views_from_csv(csv);
+	assert(expected.len == views.len);
+	for (int i = 0; i < views.len; ++i) {
+		assert(strview_eq_cstr(view_at(&views, i), *(char**) vec_get_item(&expected, i)));
+	}
+	vec_free(&views);
+	vec_free(&expected);
+}
+
+// random lists exercising fields across and within SIMD blocks
+static void random_csv(char *buf, int len, uint32_t *state) {
+	static const char alphabet[] = "ab ,,\t_";
+	for (int i = 0; i < len; ++i) {
+		*state = *state * 1103515245 + 12345;
+		buf[i] = alphabet[(*state >> 16) % (sizeof(alphabet) - 1)];
+	}
+	buf[len] = '\0';
+}
+
+void test_random() {
+	uint32_t state = 1;
+	char buf[201];
+	for (int round = 0; round < 1000; ++round) {
+		random_csv(buf, round % 200, &state);
+		check_same_as_vec_create_from_csv(buf);
+	}
+}
+
+static void collect(void *ctx, struct strview field) {
+	struct str *out = (struct str*) ctx;
+	str_lenconcat(out, field.ptr, field.len);
+	str_append(out, '|');
+}
+
+void test_stream() {
+	uint32_t state = 7;
+	char buf[101];
+	for (int round = 0; round < 50; ++round) {
+		random_csv(buf, 100, &state);
+		struct str expected = str_create(0);
+		csv_split(buf, 100, ',', collect, &expected);
+
+		// every chunk size, down to one byte at a time
+		for (int chunk = 1; chunk <= 100; ++chunk) {
+			struct str got = str_create(0);
+			struct csv_stream stream = csv_stream_create(',', collect, &got);
+			for (int i = 0; i < 100; i += chunk) {
+				csv_stream_feed(&stream, buf + i, i + chunk <= 100 ? chunk : 100 - i);
+			}
+			csv_stream_finish(&stream);
+			assert(got.len == expected.len);
+			assert(memcmp(got.buf, expected.buf, got.len) == 0);
+			str_free(&got);
+		}
+		str_free(&expected);
+	}
+}
+
+void test_other_delim() {
+	struct vec views = vec_create(sizeof(struct strview));
+	const char *opts = "--gc-sections:-O2: --strip-all";
+	csv_split_to_vec(opts, strlen(opts), ':', &views);
+	assert(views.len == 3);
+	assert(strview_eq_cstr(view_at(&views, 2), "--strip-all"));
+	vec_free(&views);
+}
+
+int main(void) {
+	test_split();
+	test_random();
+	test_stream();
+	test_other_delim();
+	printf("PASS!\n");
+	return 0;
+}
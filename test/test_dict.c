@@ -4,10 +4,18 @@
 
 void test_locate() {
 	struct dict dict = dict_create_str_int();
-	struct dict_entry* pentry = _dict_locate(&dict, (void*) "hello");
+	assert(_dict_locate(&dict, (void*) "hello") == NULL);
+	struct dict_entry* pentry = _dict_locate_or_reserve(&dict, (void*) "hello");
 	assert(pentry);
 	assert(pentry->flags == FREE);
 	dict_free(&dict);
+
+	dict = dict_create_str_int();
+	dict_put(&dict, strdup("hello"), (void*) 2);
+	pentry = _dict_locate(&dict, (void*) "hello");
+	assert(pentry && pentry->flags == ALLOCATED && (int) pentry->val == 2);
+	assert(_dict_locate(&dict, (void*) "world") == NULL);
+	dict_free(&dict);
 }
 
 void test_basic() {
@@ -45,11 +53,421 @@ void test_foreach() {
 	dict_free(&dict);
 }
 
+void test_swiss() {
+	struct dict dict = dict_create_swiss(str_hash_fn, str_eq_fn, 1, 0);
+	char buf[16];
+	for (int i = 0; i < 10000; ++i) {
+		snprintf(buf, sizeof(buf), "key%d", i);
+		assert(dict_put(&dict, strdup(buf), (void*) i) == 1);
+	}
+	// update an existing key
+	assert(dict_put(&dict, strdup("key7"), (void*) 70) == 0);
+	assert(dict.size == 10000);
+	for (int i = 0; i < 10000; ++i) {
+		snprintf(buf, sizeof(buf), "key%d", i);
+		assert((int) dict_find_nomiss(&dict, buf) == (i == 7 ? 70 : i));
+	}
+	assert(dict_find(&dict, "key10000") == NULL);
+
+	int cnt = 0;
+	DICT_FOREACH(&dict, entry) {
+		++cnt;
+	}
+	assert(cnt == 10000);
+	dict_free(&dict);
+}
+
+static int nhash_call = 0;
+
+static uint32_t counting_int_hash_fn(void *key) {
+	++nhash_call;
+	return (uint32_t) (uintptr_t) key * 2654435761u;
+}
+
+static bool int_eq_fn(void *lhs, void *rhs) {
+	return lhs == rhs;
+}
+
+void test_cached_hash() {
+	struct dict dict = dict_create(counting_int_hash_fn, int_eq_fn, 0, 0);
+	nhash_call = 0;
+	for (int i = 1; i <= 1000; ++i) {
+		dict_put(&dict, (void*) (uintptr_t) i, (void*) (uintptr_t) i);
+	}
+	// growing the table does not call the hash function again
+	assert(nhash_call == 1000);
+	assert(dict.capacity > 64);
+	dict_free(&dict);
+}
+
+void test_incremental_rehash() {
+	for (int layout = DICT_LINEAR; layout <= DICT_SWISS; ++layout) {
+		struct dict dict = layout == DICT_SWISS
+			? dict_create_swiss(str_hash_fn, str_eq_fn, 1, 0)
+			: dict_create_str_int();
+		dict_set_incremental_rehash(&dict, true);
+		char buf[16];
+		bool seen_rehash = false;
+		for (int i = 0; i < 5000; ++i) {
+			snprintf(buf, sizeof(buf), "key%d", i);
+			assert(dict_put(&dict, strdup(buf), (void*) i) == 1);
+			seen_rehash |= dict.rehash_src != NULL;
+			// everything inserted so far is visible in the middle of a rehash
+			snprintf(buf, sizeof(buf), "key%d", i / 2);
+			assert((int) dict_find_nomiss(&dict, buf) == i / 2);
+		}
+		assert(seen_rehash);
+		// update a key that may still be in the old table
+		assert(dict_put(&dict, strdup("key0"), (void*) 100) == 0);
+		assert(dict.size == 5000);
+		assert((int) dict_find_nomiss(&dict, "key0") == 100);
+
+		int cnt = 0;
+		DICT_FOREACH(&dict, entry) {
+			++cnt;
+		}
+		assert(cnt == 5000);
+		assert(dict.rehash_src == NULL);
+		dict_free(&dict);
+	}
+}
+
+static uint32_t same_hash_fn(void *key) {
+	return 7;
+}
+
+void test_rehash_finish() {
+	// every key hashes the same so the old table is one cluster of ALLOCATED
+	// slots when the rehash starts
+	for (int layout = DICT_LINEAR; layout <= DICT_SWISS; ++layout) {
+		struct dict dict = layout == DICT_SWISS
+			? dict_create_swiss(same_hash_fn, str_eq_fn, 1, 0)
+			: dict_create(same_hash_fn, str_eq_fn, 1, 0);
+		dict_set_incremental_rehash(&dict, true);
+		char buf[16];
+		int n = 0;
+		while (!dict.rehash_src) {
+			snprintf(buf, sizeof(buf), "key%d", n);
+			dict_put(&dict, strdup(buf), (void*) n);
+			++n;
+		}
+		// iterating right after the put that started the rehash finishes it
+		int cnt = 0;
+		DICT_FOREACH(&dict, entry) {
+			++cnt;
+		}
+		assert(dict.rehash_src == NULL);
+		assert(cnt == n && dict.size == n);
+		for (int i = 0; i < n; ++i) {
+			snprintf(buf, sizeof(buf), "key%d", i);
+			assert((int) dict_find_nomiss(&dict, buf) == i);
+		}
+		dict_free(&dict);
+	}
+}
+
+void test_remove() {
+	struct dict dict = dict_create_str_int();
+	dict_put(&dict, strdup("hello"), (void*) 2);
+	dict_put(&dict, strdup("world"), (void*) 3);
+	assert(dict_remove(&dict, "hello") == 1);
+	assert(dict_remove(&dict, "hello") == 0);
+	assert(dict_find(&dict, "hello") == NULL);
+	assert((int) dict_find_nomiss(&dict, "world") == 3);
+	assert(dict.size == 1);
+	dict_free(&dict);
+}
+
+/*
+ * Insert and remove random int keys and compare with a plain array.
+ */
+void test_churn() {
+	enum { NKEY = 4096 };
+	for (int mode = 0; mode < 6; ++mode) {
+		int layout = mode % 3;
+		struct dict dict = layout == DICT_SWISS
+			? dict_create_swiss(counting_int_hash_fn, int_eq_fn, 0, 0)
+			: layout == DICT_COMPACT
+			? dict_create_compact(counting_int_hash_fn, int_eq_fn, 0, 0)
+			: dict_create(counting_int_hash_fn, int_eq_fn, 0, 0);
+		dict_set_incremental_rehash(&dict, mode >= 3);
+		static bool present[NKEY];
+		memset(present, 0, sizeof(present));
+		int npresent = 0;
+		uint32_t rnd = 12345;
+		for (int i = 0; i < 200000; ++i) {
+			rnd = rnd * 1103515245 + 12345;
+			// keys start from 1 so they are never NULL
+			uintptr_t key = 1 + (rnd >> 8) % NKEY;
+			if ((rnd >> 4) & 1) {
+				int created = dict_put(&dict, (void*) key, (void*) key);
+				assert(created == !present[key - 1]);
+				npresent += created;
+				present[key - 1] = true;
+			} else {
+				int removed = dict_remove(&dict, (void*) key);
+				assert(removed == present[key - 1]);
+				npresent -= removed;
+				present[key - 1] = false;
+			}
+			assert(dict.size == npresent);
+		}
+		for (uintptr_t key = 1; key <= NKEY; ++key) {
+			struct dict_entry* entry = dict_find(&dict, (void*) key);
+			assert((entry != NULL) == present[key - 1]);
+			assert(!entry || entry->val == (void*) key);
+		}
+		int cnt = 0;
+		DICT_FOREACH(&dict, entry) {
+			++cnt;
+			if (dict.layout == DICT_LINEAR) {
+				// Robin Hood invariant: the previous slot is never closer to its
+				// home than this one minus one.
+				int idx = entry - dict.entries;
+				int prev = idx == 0 ? dict.capacity - 1 : idx - 1;
+				int dist = _dict_probe_dist(&dict, idx);
+				assert(dist == 0 || (dict.entries[prev].flags == ALLOCATED && _dict_probe_dist(&dict, prev) >= dist - 1));
+			}
+		}
+		assert(cnt == npresent);
+		dict_free(&dict);
+	}
+}
+
+void test_compact() {
+	struct dict dict = dict_create_compact(str_hash_fn, str_eq_fn, 1, 0);
+	char buf[16];
+	for (int i = 0; i < 1000; ++i) {
+		snprintf(buf, sizeof(buf), "key%d", i);
+		assert(dict_put(&dict, strdup(buf), (void*) i) == 1);
+	}
+	// the entries array only has room up to the load limit
+	assert(dict_end(&dict) - dict.entries == 1000);
+
+	// updating keeps the position, removing and putting again moves to the end
+	assert(dict_put(&dict, strdup("key0"), (void*) 0) == 0);
+	assert(dict_remove(&dict, "key1") == 1);
+	assert(dict_put(&dict, strdup("key1"), (void*) 1) == 1);
+	for (int i = 2; i < 1000; i += 2) {
+		snprintf(buf, sizeof(buf), "key%d", i);
+		assert(dict_remove(&dict, buf) == 1);
+	}
+	// 0, 3, 5, ..., 999, 1
+	int expected = 0, cnt = 0;
+	DICT_FOREACH(&dict, entry) {
+		assert((int) entry->val == expected);
+		expected = expected == 999 ? 1 : expected == 0 ? 3 : expected + 2;
+		++cnt;
+	}
+	assert(cnt == 501 && dict.size == 501);
+
+	// growing squeezes out the holes
+	for (int i = 1000; i < 3000; ++i) {
+		snprintf(buf, sizeof(buf), "key%d", i);
+		assert(dict_put(&dict, strdup(buf), (void*) i) == 1);
+	}
+	assert(dict.ndeleted == 0);
+	assert((int) dict_find_nomiss(&dict, "key1") == 1);
+	assert((int) dict_find_nomiss(&dict, "key2999") == 2999);
+	assert(dict_find(&dict, "key2") == NULL);
+
+	dict_set_max_load_pct(&dict, 90);
+	assert(dict.ndeleted == 0);
+	assert(dict.entries[0].val == (void*) 0 && dict.entries[1].val == (void*) 3);
+	for (int i = 3000; i < 6000; ++i) {
+		snprintf(buf, sizeof(buf), "key%d", i);
+		assert(dict_put(&dict, strdup(buf), (void*) i) == 1);
+	}
+	cnt = 0;
+	DICT_FOREACH(&dict, entry) {
+		assert((int) dict_find_nomiss(&dict, entry->key) == (int) entry->val);
+		++cnt;
+	}
+	assert(cnt == dict.size && cnt == 5501);
+	dict_free(&dict);
+}
+
+void test_seeded_hash() {
+	struct dict d1 = dict_create_str_int();
+	struct dict d2 = dict_create_swiss(str_hash_fn, str_eq_fn, 1, 0);
+	dict_use_seeded_hash(&d1, str_hash_seeded_fn);
+	dict_use_seeded_hash(&d2, str_crc32c_seeded_fn);
+	assert(d1.seed != d2.seed);
+	char buf[16];
+	for (int i = 0; i < 1000; ++i) {
+		snprintf(buf, sizeof(buf), "key%d", i);
+		dict_put(&d1, strdup(buf), (void*) i);
+		dict_put(&d2, strdup(buf), (void*) i);
+	}
+	for (int i = 0; i < 1000; ++i) {
+		snprintf(buf, sizeof(buf), "key%d", i);
+		assert((int) dict_find_nomiss(&d1, buf) == i);
+		assert((int) dict_find_nomiss(&d2, buf) == i);
+	}
+	dict_free(&d1);
+	dict_free(&d2);
+}
+
+void test_capacity() {
+	struct dict dict = dict_create_with_capacity(str_hash_fn, str_eq_fn, 1, 0, 1000);
+	int capacity = dict.capacity;
+	assert(capacity >= 2000);
+	char buf[16];
+	for (int i = 0; i < 1000; ++i) {
+		snprintf(buf, sizeof(buf), "key%d", i);
+		dict_put(&dict, strdup(buf), (void*) i);
+	}
+	// never grew
+	assert(dict.capacity == capacity);
+
+	dict_reserve(&dict, 5000);
+	capacity = dict.capacity;
+	assert(capacity >= 10000);
+	for (int i = 1000; i < 5000; ++i) {
+		snprintf(buf, sizeof(buf), "key%d", i);
+		dict_put(&dict, strdup(buf), (void*) i);
+	}
+	assert(dict.capacity == capacity);
+
+	// a higher load factor never needs more slots than 1 / load
+	dict_set_max_load_pct(&dict, 90);
+	assert(dict.capacity == capacity);
+	// a lower one grows right away
+	dict_set_max_load_pct(&dict, 20);
+	assert(dict.capacity * 20 > dict.size * 100);
+	for (int i = 0; i < 5000; ++i) {
+		snprintf(buf, sizeof(buf), "key%d", i);
+		assert((int) dict_find_nomiss(&dict, buf) == i);
+	}
+	dict_free(&dict);
+}
+
+void test_build_from_arrays() {
+	enum { N = 3000 };
+	void *keys[N + 1], *vals[N + 1];
+	char buf[16];
+	for (int i = 0; i < N; ++i) {
+		snprintf(buf, sizeof(buf), "key%d", i);
+		keys[i] = strdup(buf);
+		vals[i] = (void*) i;
+	}
+	// a duplicate. The last one wins.
+	keys[N] = strdup("key5");
+	vals[N] = (void*) -5;
+	struct dict dict = dict_build_from_arrays(str_hash_fn, str_eq_fn, 1, 0, keys, vals, N + 1);
+	assert(dict.size == N);
+	for (int i = 0; i < N; ++i) {
+		snprintf(buf, sizeof(buf), "key%d", i);
+		assert((int) dict_find_nomiss(&dict, buf) == (i == 5 ? -5 : i));
+	}
+	dict_free(&dict);
+}
+
+void test_find_batch() {
+	// just past a resize so an incremental rehash is still in progress
+	enum { N = 1030 };
+	char *keys[2 * N + 3];
+	struct dict_entry *out[2 * N + 3];
+	char buf[16];
+	for (int i = 0; i < 2 * N + 3; ++i) {
+		snprintf(buf, sizeof(buf), "key%d", i);
+		keys[i] = strdup(buf);
+	}
+	for (int mode = 0; mode < 4; ++mode) {
+		struct dict dict = mode == DICT_SWISS
+			? dict_create_swiss(str_hash_fn, str_eq_fn, 0, 0)
+			: mode == DICT_COMPACT
+			? dict_create_compact(str_hash_fn, str_eq_fn, 0, 0)
+			: dict_create(str_hash_fn, str_eq_fn, 0, 0);
+		// the last mode starts in the middle of an incremental rehash
+		dict_set_incremental_rehash(&dict, mode == 3);
+		for (int i = 0; i < N; ++i) {
+			dict_put(&dict, keys[2 * i], (void*) i);
+		}
+		assert(mode != 3 || dict.rehash_src);
+		// odd counts to cover a partial group
+		dict_find_batch(&dict, (void**) keys, 2 * N + 3, out);
+		for (int i = 0; i < 2 * N + 3; ++i) {
+			if (i % 2 == 0 && i < 2 * N) {
+				assert(out[i] && (int) out[i]->val == i / 2);
+			} else {
+				assert(out[i] == NULL);
+			}
+		}
+		dict_find_batch(&dict, (void**) keys, 0, out);
+		dict_free(&dict);
+	}
+	for (int i = 0; i < 2 * N + 3; ++i) {
+		free(keys[i]);
+	}
+}
+
+void test_find_view() {
+	// keys are substrings of a larger buffer, not '\0' terminated
+	const char *text = "key0key1key2key10";
+	for (int mode = 0; mode < 4; ++mode) {
+		struct dict dict = mode == DICT_SWISS
+			? dict_create_swiss(str_hash_fn, str_eq_fn, 1, 0)
+			: mode == DICT_COMPACT
+			? dict_create_compact(str_hash_fn, str_eq_fn, 1, 0)
+			: dict_create_str_int();
+		// the last mode uses a random seed
+		if (mode == 3) {
+			dict_use_seeded_hash(&dict, str_hash_seeded_fn);
+		}
+		dict_put(&dict, strdup("key1"), (void*) 1);
+		dict_put(&dict, strdup("key10"), (void*) 10);
+		struct dict_entry *entry = dict_find_view(&dict, strview_create(text + 4, 4));
+		assert(entry && (int) entry->val == 1);
+		entry = dict_find_view(&dict, strview_create(text + 12, 5));
+		assert(entry && (int) entry->val == 10);
+		assert(dict_find_view(&dict, strview_create(text, 4)) == NULL);
+		assert(dict_find_view(&dict, strview_create(text + 12, 3)) == NULL);
+		// the regular lookup is unaffected
+		assert((int) dict_find_nomiss(&dict, "key10") == 10);
+		dict_free(&dict);
+	}
+
+	// in the middle of an incremental rehash, keys are found in both tables
+	// and the lookup does not move anything
+	struct dict dict = dict_create_str_int();
+	dict_set_incremental_rehash(&dict, true);
+	char buf[16];
+	for (int i = 0; i < 1030; ++i) {
+		snprintf(buf, sizeof(buf), "key%d", i);
+		dict_put(&dict, strdup(buf), (void*) i);
+	}
+	assert(dict.rehash_src);
+	struct dict *src = dict.rehash_src;
+	int rehash_idx = dict.rehash_idx;
+	for (int i = 0; i < 1030; ++i) {
+		int len = snprintf(buf, sizeof(buf), "key%dx", i);
+		struct dict_entry *entry = dict_find_view(&dict, strview_create(buf, len - 1));
+		assert(entry && (int) entry->val == i);
+	}
+	assert(dict_find_view(&dict, strview_from_cstr("key1030")) == NULL);
+	assert(dict.rehash_src == src && dict.rehash_idx == rehash_idx);
+	assert(dict.eq_fn == str_eq_fn);
+	dict_free(&dict);
+}
+
 int main(void) {
 	test_locate();
 	test_basic();
 	test_insert_many();
   test_foreach();
+	test_swiss();
+	test_cached_hash();
+	test_incremental_rehash();
+	test_rehash_finish();
+	test_remove();
+	test_churn();
+	test_compact();
+	test_seeded_hash();
+	test_capacity();
+	test_build_from_arrays();
+	test_find_batch();
+	test_find_view();
 	printf("PASS!\n");
 	return 0;
 }
@@ -0,0 +1,76 @@
+#include "scom/dict_define.h"
+#include <assert.h>
+#include <stdio.h>
+
+DICT_DEFINE(int_int_dict, int, int, dict_int_hash, dict_int_eq)
+DICT_DEFINE(str_int_dict, const char*, int, dict_cstr_hash, dict_cstr_eq)
+
+struct point {
+	int x, y, z;
+};
+
+DICT_DEFINE(int_point_dict, int, struct point, dict_int_hash, dict_int_eq)
+
+void test_basic() {
+	struct str_int_dict dict = str_int_dict_create();
+	assert(str_int_dict_put(&dict, "hello", 2) == 1);
+	assert(str_int_dict_put(&dict, "world", 3) == 1);
+	assert(str_int_dict_put(&dict, "hello", 4) == 0);
+	assert(str_int_dict_find(&dict, "hello")->val == 4);
+	assert(str_int_dict_find(&dict, "world")->val == 3);
+	assert(str_int_dict_find(&dict, "NOT_FOUND") == NULL);
+	assert(dict.size == 2);
+	str_int_dict_free(&dict);
+}
+
+void test_inline_struct_value() {
+	struct int_point_dict dict = int_point_dict_create();
+	for (int i = 0; i < 1000; ++i) {
+		struct point p = {i, i * 2, i * 3};
+		int_point_dict_put(&dict, i, p);
+	}
+	for (int i = 0; i < 1000; ++i) {
+		struct point *p = &int_point_dict_find(&dict, i)->val;
+		assert(p->x == i && p->y == i * 2 && p->z == i * 3);
+	}
+	int_point_dict_free(&dict);
+}
+
+void test_churn() {
+	enum { NKEY = 2048 };
+	static bool present[NKEY];
+	struct int_int_dict dict = int_int_dict_create();
+	int npresent = 0;
+	uint32_t rnd = 1;
+	for (int i = 0; i < 100000; ++i) {
+		rnd = rnd * 1103515245 + 12345;
+		int key = (rnd >> 8) % NKEY;
+		if ((rnd >> 4) & 1) {
+			int created = int_int_dict_put(&dict, key, key * 7);
+			assert(created == !present[key]);
+			npresent += created;
+			present[key] = true;
+		} else {
+			int removed = int_int_dict_remove(&dict, key);
+			assert(removed == present[key]);
+			npresent -= removed;
+			present[key] = false;
+		}
+	}
+	assert(dict.size == npresent);
+	int cnt = 0;
+	DICT_DEFINE_FOREACH(int_int_dict, &dict, entry) {
+		assert(present[entry->key] && entry->val == entry->key * 7);
+		++cnt;
+	}
+	assert(cnt == npresent);
+	int_int_dict_free(&dict);
+}
+
+int main(void) {
+	test_basic();
+	test_inline_struct_value();
+	test_churn();
+	printf("PASS!\n");
+	return 0;
+}
@@ -0,0 +1,72 @@
+#define DICT_STATS
+#include "scom/dict.h"
+#include <assert.h>
+#include <stdio.h>
+
+void test_counters() {
+	struct dict dict = dict_create_str_int();
+	char buf[16];
+	for (int i = 0; i < 1000; ++i) {
+		snprintf(buf, sizeof(buf), "key%d", i);
+		dict_put(&dict, strdup(buf), (void*) i);
+	}
+	for (int i = 0; i < 1500; ++i) {
+		snprintf(buf, sizeof(buf), "key%d", i);
+		assert((dict_find(&dict, buf) != NULL) == (i < 1000));
+	}
+	struct dict_stats stats = dict_stats_get(&dict);
+	assert(stats.nfind == 1500);
+	assert(stats.nhit == 1000);
+	assert(stats.nmiss == 500);
+	// every hit compares the key at least once
+	assert(stats.neq >= 1000);
+	// 64 -> 128 -> ... -> 2048
+	assert(stats.nexpand == 5);
+	assert(stats.peak_capacity == 2048 && stats.peak_capacity == dict.capacity);
+	uint64_t nprobe = 0;
+	for (int i = 0; i < DICT_PROBE_HIST_SIZE; ++i) {
+		nprobe += stats.probe_hist[i];
+	}
+	// at least one probe sequence per put and find
+	assert(nprobe >= 2500);
+	assert(stats.probe_hist[0] > 0);
+	dict_stats_dump(&dict, stdout);
+
+	dict_stats_reset(&dict);
+	stats = dict_stats_get(&dict);
+	assert(stats.nfind == 0 && stats.neq == 0 && stats.nexpand == 0);
+	assert(stats.peak_capacity == dict.capacity);
+	dict_free(&dict);
+}
+
+void test_layouts() {
+	struct dict dicts[] = {
+		dict_create_swiss(str_hash_fn, str_eq_fn, 1, 0),
+		dict_create_compact(str_hash_fn, str_eq_fn, 1, 0),
+	};
+	char buf[16];
+	for (int j = 0; j < 2; ++j) {
+		struct dict* dict = &dicts[j];
+		for (int i = 0; i < 1000; ++i) {
+			snprintf(buf, sizeof(buf), "key%d", i);
+			dict_put(dict, strdup(buf), (void*) i);
+		}
+		for (int i = 0; i < 2000; ++i) {
+			snprintf(buf, sizeof(buf), "key%d", i);
+			dict_find(dict, buf);
+		}
+		struct dict_stats stats = dict_stats_get(dict);
+		assert(stats.nhit == 1000 && stats.nmiss == 1000);
+		assert(stats.nexpand > 0);
+		assert(stats.probe_hist[0] > 0);
+		dict_stats_dump(dict, stdout);
+		dict_free(dict);
+	}
+}
+
+int main(void) {
+	test_counters();
+	test_layouts();
+	printf("PASS!\n");
+	return 0;
+}
@@ -37,6 +37,40 @@ void test_syms2() {
 	elfr_free(&elfr);
 }
 
+void test_sym_views() {
+	struct elf_reader elfr = elfr_create(ELF_FILE_PATH);
+	struct vec names = vec_create(sizeof(struct strview));
+	struct vec weaks = vec_create(sizeof(bool));
+
+	elfr_get_global_defined_sym_views(&elfr, &names, &weaks);
+	int idx = vec_strview_find(&names, strview_from_cstr("sumsin"));
+	assert(idx >= 0);
+	assert(*(bool*) vec_get_item(&weaks, idx));
+	assert(vec_strview_find(&names, strview_from_cstr("sum")) >= 0);
+
+	// same names as the char* version, in the same order
+	struct vec cnames = elfr_get_global_defined_syms(&elfr);
+	assert(cnames.len == names.len);
+	for (int i = 0; i < names.len; ++i) {
+		assert(strview_eq_cstr(*(struct strview*) vec_get_item(&names, i), *(char**) vec_get_item(&cnames, i)));
+	}
+	// same views with and without the prebuilt lengths
+	assert(elfr.symnames == NULL);
+	for (int pass = 0; pass < 2; ++pass) {
+		for (int i = 0; i < elfr.symtab_size; ++i) {
+			struct strview name = elfr_get_symname(&elfr, i);
+			assert(name.ptr == elfr.symstr + elfr.symtab[i].st_name && name.ptr[name.len] == '\0');
+		}
+		elfr_build_symnames(&elfr);
+		assert(elfr.symnames != NULL);
+	}
+
+	vec_free(&cnames);
+	vec_free(&names);
+	vec_free(&weaks);
+	elfr_free(&elfr);
+}
+
 void test_syms() {
 	struct elf_reader elfr = elfr_create(ELF_FILE_PATH);
 	struct vec defined_syms = elfr_get_global_defined_syms(&elfr);
@@ -45,7 +79,7 @@ void test_syms() {
 	vec_free(&defined_syms);
 
 	struct vec undefined_syms = elfr_get_undefined_syms(&elfr);
-	printf("undefined_syms len %d\n", undefined_syms.len);
+	printf("undefined_syms len %zu\n", undefined_syms.len);
 	assert(vec_str_find(&undefined_syms, "sin") >= 0);
 	vec_free(&undefined_syms);
 	elfr_free(&elfr);
@@ -63,6 +97,36 @@ void test_elfr_create_from_buffer() {
 	free(buf);
 }
 
+void test_create_mmap() {
+	struct elf_reader heap = elfr_create(ELF_FILE_PATH);
+	struct vec heap_syms = elfr_get_global_defined_syms(&heap);
+	for (int writable = 0; writable < 2; ++writable) {
+		struct elf_reader elfr = elfr_create_mmap(ELF_FILE_PATH, writable);
+		assert(elfr.mapped && !elfr.own_buf && elfr.file_size == heap.file_size);
+		assert(memcmp(elfr.buf, heap.buf, heap.file_size) == 0);
+		assert(elfr.symstr > elfr.buf && elfr.symstr < elfr.buf + elfr.file_size);
+		assert(elfr_get_shdr_by_name(&elfr, ".text") != NULL);
+		struct vec syms = elfr_get_global_defined_syms(&elfr);
+		assert(syms.len == heap_syms.len);
+		for (int i = 0; i < syms.len; ++i) {
+			assert(strcmp(*(char**) vec_get_item(&syms, i), *(char**) vec_get_item(&heap_syms, i)) == 0);
+		}
+		vec_free(&syms);
+		if (writable) {
+			// the private mapping can be patched without touching the file
+			elfr.symstr[1] ^= 0x20;
+			int file_size;
+			char *buf = _elfr_read_file(ELF_FILE_PATH, &file_size);
+			assert(memcmp(buf, heap.buf, file_size) == 0);
+			free(buf);
+		}
+		elfr_free(&elfr);
+		assert(elfr.buf == NULL);
+	}
+	vec_free(&heap_syms);
+	elfr_free(&heap);
+}
+
 int main(int argc, char** argv) {
 	if (argc >= 2) {
 		ELF_FILE_PATH = argv[1];
@@ -73,7 +137,9 @@ int main(int argc, char** argv) {
 	test_text_section_exists();
 	test_syms();
 	test_syms2();
+	test_sym_views();
 	test_elfr_create_from_buffer();
+	test_create_mmap();
 	printf("PASS!\n");
 	return 0;
 }
@@ -5,13 +5,18 @@
 #include <sys/errno.h>
 
 #include "scom/elf_writer.h"
+#include "scom/elf_reader.h"
 
 void test_create_and_free() {
 	struct elf_writer elfw = elfw_create();
 	elfw_free(&elfw);
 }
 
-void test_hand_crafted_file() {
+/*
+ * With 'chunked' the text is passed as a chunkbuf with tiny blocks so it is
+ * written with several iovecs.
+ */
+void test_hand_crafted_file(bool chunked) {
   /*
   asm:
     mov $1, %eax
@@ -24,13 +29,21 @@ void test_hand_crafted_file() {
   */
   uint8_t child_exit_code = 52;
   struct str textstr = str_create(16);
-  str_append(&textstr, 0xb8); str_append(&textstr, 0x01); str_append(&textstr, 0x00); str_append(&textstr, 0x00); str_append(&textstr, 0x00);
-  str_append(&textstr, 0xbb); str_append(&textstr, child_exit_code); str_append(&textstr, 0x00); str_append(&textstr, 0x00); str_append(&textstr, 0x00);
-  str_append(&textstr, 0xcd); str_append(&textstr, 0x80);
+  str_put_u8(&textstr, 0xb8); str_put_u32(&textstr, 1);
+  str_put_u8(&textstr, 0xbb); str_put_u32(&textstr, child_exit_code);
+  str_put_u16(&textstr, 0x80cd);
 
   const char* path = "/tmp/manual.elf";
   struct elf_writer writer = elfw_create();
-  elfw_manual_text(&writer, &textstr);
+  if (chunked) {
+    struct chunkbuf textbuf = chunkbuf_create(4);
+    chunkbuf_append(&textbuf, textstr.buf, textstr.len);
+    str_free(&textstr);
+    writer.ehdr.e_entry = writer.next_va;
+    elfw_create_chunked_segment(&writer, ".text", &textbuf, textbuf.len);
+  } else {
+    elfw_manual_text(&writer, &textstr);
+  }
   elfw_write(&writer, path);
   elfw_free(&writer);
 
@@ -65,9 +78,48 @@ void test_hand_crafted_file() {
   printf("\033[32mSucceed!\033[0m\n");
 }
 
+/*
+ * Section names are kept by ID until the file is written, and writing twice
+ * produces the same file.
+ */
+void test_section_names() {
+  struct str textstr = str_create(16);
+  str_fill(&textstr, 16, 0x90);
+  struct elf_writer writer = elfw_create();
+  elfw_manual_text(&writer, &textstr);
+  int rel_idx = elfw_add_shdr(&writer, ".rel.text", SHT_PROGBITS, 0, 0, 0, 1, 0);
+  int text_idx = elfw_add_shdr(&writer, ".text", SHT_PROGBITS, 0, 0, 0, 1, 0);
+  assert(strcmp(elfw_get_shdr_name(&writer, rel_idx), ".rel.text") == 0);
+  assert(strcmp(elfw_get_shdr_name(&writer, text_idx), ".text") == 0);
+
+  const char* paths[] = {"/tmp/names1.elf", "/tmp/names2.elf"};
+  elfw_write(&writer, paths[0]);
+  elfw_write(&writer, paths[1]);
+  // the headers in the writer are untouched
+  assert(strcmp(elfw_get_shdr_name(&writer, text_idx), ".text") == 0);
+  elfw_free(&writer);
+
+  int size1, size2;
+  char *buf1 = _elfr_read_file(paths[0], &size1);
+  char *buf2 = _elfr_read_file(paths[1], &size2);
+  assert(size1 == size2 && memcmp(buf1, buf2, size1) == 0);
+  free(buf2);
+  struct elf_reader reader = elfr_create_from_buffer(buf1, size1, true);
+  assert(elfr_get_shdr_by_name(&reader, ".rel.text") == elfr_get_shdr(&reader, rel_idx));
+  assert(elfr_get_shdr_by_name(&reader, ".text") == elfr_get_shdr(&reader, text_idx));
+  assert(elfr_get_shdr_by_name(&reader, ".shstrtab") == elfr_get_shdr(&reader, reader.ehdr->e_shstrndx));
+  // ".text" is tail merged into ".rel.text"
+  assert(elfr_get_shdr(&reader, text_idx)->sh_name == elfr_get_shdr(&reader, rel_idx)->sh_name + 4);
+  elfr_free(&reader);
+  unlink(paths[0]);
+  unlink(paths[1]);
+}
+
 int main(void) {
 	test_create_and_free();
-	test_hand_crafted_file();
+	test_hand_crafted_file(false);
+	test_hand_crafted_file(true);
+	test_section_names();
 	printf("PASS!\n");
 	return 0;
 }
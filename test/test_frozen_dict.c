@@ -0,0 +1,133 @@
+#include "scom/frozen_dict.h"
+#include <assert.h>
+#include <stdio.h>
+#include <signal.h>
+#include <sys/wait.h>
+
+static const char *path = "/tmp/test_frozen_dict.fd";
+
+void test_basic() {
+	struct dict src = dict_create(str_hash_fn, str_eq_fn, 0, 0);
+	dict_put(&src, "main", (void*) 0x1000);
+	dict_put(&src, "printf", (void*) 0x2000);
+	dict_put(&src, "", (void*) 7);
+	struct str image = frozen_dict_build(&src);
+	dict_free(&src);
+
+	struct frozen_dict fd = frozen_dict_from_buffer(image.buf, image.len);
+	uint64_t val = 0;
+	assert(frozen_dict_size(&fd) == 3);
+	assert(frozen_dict_find(&fd, "main", &val) && val == 0x1000);
+	assert(frozen_dict_find(&fd, "printf", &val) && val == 0x2000);
+	assert(frozen_dict_find(&fd, "", &val) && val == 7);
+	assert(frozen_dict_lenfind(&fd, "mainly", 4, &val) && val == 0x1000);
+	assert(!frozen_dict_find(&fd, "mai", NULL));
+	assert(!frozen_dict_find(&fd, "NOT_FOUND", NULL));
+	str_free(&image);
+}
+
+void test_empty() {
+	struct dict src = dict_create(str_hash_fn, str_eq_fn, 0, 0);
+	struct str image = frozen_dict_build(&src);
+	dict_free(&src);
+	struct frozen_dict fd = frozen_dict_from_buffer(image.buf, image.len);
+	assert(frozen_dict_size(&fd) == 0);
+	assert(!frozen_dict_find(&fd, "a", NULL));
+	str_free(&image);
+}
+
+void test_mmap() {
+	int n = 100000;
+	char buf[32];
+	struct dict src = dict_create(str_hash_fn, str_eq_fn, 1, 0);
+	for (int i = 0; i < n; ++i) {
+		snprintf(buf, sizeof(buf), "sym%d", i);
+		dict_put(&src, strdup(buf), (void*) (uintptr_t) (i * 3));
+	}
+	struct str image = frozen_dict_build(&src);
+	dict_free(&src);
+	frozen_dict_write(&image, path);
+	str_free(&image);
+
+	struct frozen_dict fd = frozen_dict_open(path);
+	assert(fd.map);
+	assert(frozen_dict_size(&fd) == n);
+	// minimal: every slot holds a key
+	assert(fd.hdr->slot_off + n * sizeof(struct frozen_dict_slot) == fd.hdr->str_off);
+	for (int i = 0; i < n; ++i) {
+		uint64_t val = 0;
+		snprintf(buf, sizeof(buf), "sym%d", i);
+		assert(frozen_dict_find(&fd, buf, &val));
+		assert(val == i * 3);
+		snprintf(buf, sizeof(buf), "nosym%d", i);
+		assert(!frozen_dict_find(&fd, buf, NULL));
+	}
+	frozen_dict_close(&fd);
+	unlink(path);
+}
+
+/*
+ * Open the image and look up 'key' in a child process. Return whether it
+ * aborted on a failed CHECK.
+ */
+static bool aborts(const char *buf, size_t size, const char *key) {
+	fflush(stdout);
+	pid_t pid = fork();
+	assert(pid >= 0);
+	if (pid == 0) {
+		// keep the expected CHECK message out of the test output
+		freopen("/dev/null", "w", stderr);
+		struct frozen_dict fd = frozen_dict_from_buffer(buf, size);
+		frozen_dict_find(&fd, key, NULL);
+		exit(0);
+	}
+	int status;
+	waitpid(pid, &status, 0);
+	return WIFSIGNALED(status) && WTERMSIG(status) == SIGABRT;
+}
+
+void test_corrupt_image() {
+	struct dict src = dict_create(str_hash_fn, str_eq_fn, 0, 0);
+	dict_put(&src, "main", (void*) 0x1000);
+	dict_put(&src, "printf", (void*) 0x2000);
+	struct str image = frozen_dict_build(&src);
+	dict_free(&src);
+	struct frozen_dict_header *hdr = (struct frozen_dict_header*) image.buf;
+	assert(!aborts(image.buf, image.len, "main"));
+
+	// truncated
+	assert(aborts(image.buf, sizeof(*hdr) - 1, "main"));
+	assert(aborts(image.buf, image.len - 1, "main"));
+	// tables pointing past the end
+	struct frozen_dict_header saved = *hdr;
+	hdr->disp_off = hdr->image_size;
+	assert(aborts(image.buf, image.len, "main"));
+	*hdr = saved;
+	hdr->nkey = 1000;
+	assert(aborts(image.buf, image.len, "main"));
+	*hdr = saved;
+	hdr->str_off = hdr->image_size + 1;
+	assert(aborts(image.buf, image.len, "main"));
+	*hdr = saved;
+	hdr->nbucket = 0;
+	assert(aborts(image.buf, image.len, "main"));
+	*hdr = saved;
+	// a slot whose key string is out of range fails at lookup
+	struct frozen_dict_slot *slots = (struct frozen_dict_slot*) (image.buf + hdr->slot_off);
+	for (int i = 0; i < 2; ++i) {
+		slots[i].key_off = 0xfffffff0;
+	}
+	// a key of another length never reads the string
+	assert(!aborts(image.buf, image.len, "x"));
+	assert(aborts(image.buf, image.len, "main"));
+	str_free(&image);
+}
+
+int main(void) {
+	test_basic();
+	test_empty();
+	test_mmap();
+	test_corrupt_image();
+	printf("PASS!\n");
+	return 0;
+}
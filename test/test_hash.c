@@ -0,0 +1,68 @@
+#include "scom/hash.h"
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+void test_crc32c_check_value() {
+	// the standard check value of CRC32C
+	const char *s = "123456789";
+	assert((_hash_crc32c_sw((const uint8_t*) s, 9, ~0u) ^ ~0u) == 0xE3069283);
+#ifdef HASH_HAVE_X86
+	if (hash_crc32c_is_hw()) {
+		assert((_hash_crc32c_hw((const uint8_t*) s, 9, ~0u) ^ ~0u) == 0xE3069283);
+	}
+#endif
+}
+
+void test_crc32c_hw_matches_sw() {
+#ifdef HASH_HAVE_X86
+	if (!hash_crc32c_is_hw()) {
+		return;
+	}
+	uint8_t buf[64];
+	for (int i = 0; i < 64; ++i) {
+		buf[i] = i * 37 + 1;
+	}
+	for (int len = 0; len <= 64; ++len) {
+		assert(_hash_crc32c_hw(buf, len, 7) == _hash_crc32c_sw(buf, len, 7));
+	}
+#endif
+}
+
+void test_hash_bytes_lengths() {
+	// every length hashes only its own bytes and differs from its neighbors
+	char buf[80];
+	for (int i = 0; i < 80; ++i) {
+		buf[i] = 'a' + i % 26;
+	}
+	for (int len = 1; len < 80; ++len) {
+		char *copy = malloc(len);
+		memcpy(copy, buf, len);
+		assert(hash_bytes(copy, len, 0) == hash_bytes(buf, len, 0));
+		assert(hash_bytes(copy, len, 0) != hash_bytes(buf, len - 1, 0));
+		assert(hash_bytes(copy, len, 0) != hash_bytes(copy, len, 1));
+		free(copy);
+	}
+}
+
+void test_common_prefix() {
+	// names sharing a long prefix should not collide
+	char a[] = "_ZN4scom6detail10elf_reader4findEv";
+	char b[] = "_ZN4scom6detail10elf_reader4findEi";
+	assert(hash_bytes(a, strlen(a), 0) != hash_bytes(b, strlen(b), 0));
+	assert(hash_crc32c(a, strlen(a), 0) != hash_crc32c(b, strlen(b), 0));
+}
+
+void test_random_seed() {
+	assert(hash_random_seed() != hash_random_seed());
+}
+
+int main(void) {
+	test_crc32c_check_value();
+	test_crc32c_hw_matches_sw();
+	test_hash_bytes_lengths();
+	test_common_prefix();
+	test_random_seed();
+	printf("PASS!\n");
+	return 0;
+}
@@ -0,0 +1,68 @@
+#include "scom/intern.h"
+#include <assert.h>
+#include <stdio.h>
+
+void test_basic() {
+	struct intern in = intern_create();
+	uint32_t a = intern_str(&in, "hello");
+	uint32_t b = intern_str(&in, "world");
+	assert(a != b);
+	assert(intern_str(&in, "hello") == a);
+	assert(intern_lenstr(&in, "worldwide", 5) == b);
+	assert(strcmp(intern_get(&in, a), "hello") == 0);
+	assert(intern_find(&in, "world") == b);
+	assert(intern_find(&in, "NOT_FOUND") == INTERN_NONE);
+	assert(intern_size(&in) == 2);
+	intern_free(&in);
+}
+
+void test_stable_pointers() {
+	struct intern in = intern_create();
+	char buf[32];
+	const char* first = intern_get(&in, intern_str(&in, "first"));
+	for (int i = 0; i < 100000; ++i) {
+		snprintf(buf, sizeof(buf), "sym%d", i);
+		assert(intern_str(&in, buf) == i + 1);
+	}
+	// spans many chunks but the first string never moved
+	assert(in.chunks.len > 1);
+	assert(intern_get(&in, 0) == first);
+	assert(strcmp(first, "first") == 0);
+	assert(strcmp(intern_get(&in, 100000), "sym99999") == 0);
+
+	// a string bigger than a chunk
+	char* big = malloc(INTERN_CHUNK_SIZE * 2);
+	memset(big, 'x', INTERN_CHUNK_SIZE * 2 - 1);
+	big[INTERN_CHUNK_SIZE * 2 - 1] = '\0';
+	uint32_t id = intern_str(&in, big);
+	assert(strcmp(intern_get(&in, id), big) == 0);
+	assert(intern_str(&in, big) == id);
+	free(big);
+	intern_free(&in);
+}
+
+void test_strtab() {
+	struct intern in = intern_create();
+	uint32_t sum_id = intern_str(&in, "sum");
+	const char strtab[] = "\0sum.c\0sum\0sumsin\0sum";
+	struct vec offsets = vec_create(sizeof(uint32_t));
+	struct vec ids = vec_create(sizeof(uint32_t));
+	intern_strtab(&in, strtab, sizeof(strtab), &offsets, &ids);
+	assert(ids.len == 4);
+	assert(*(uint32_t*) vec_get_item(&offsets, 1) == 7);
+	assert(*(uint32_t*) vec_get_item(&ids, 1) == sum_id);
+	assert(*(uint32_t*) vec_get_item(&ids, 3) == sum_id);
+	assert(strcmp(intern_get(&in, *(uint32_t*) vec_get_item(&ids, 2)), "sumsin") == 0);
+	assert(intern_size(&in) == 3);
+	vec_free(&offsets);
+	vec_free(&ids);
+	intern_free(&in);
+}
+
+int main(void) {
+	test_basic();
+	test_stable_pointers();
+	test_strtab();
+	printf("PASS!\n");
+	return 0;
+}
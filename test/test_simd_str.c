@@ -0,0 +1,120 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include "scom/simd_str.h"
+
+static size_t ref_mismatch(const char *a, const char *b, size_t n) {
+	size_t i = 0;
+	while (i < n && a[i] == b[i]) {
+		++i;
+	}
+	return i;
+}
+
+static const char *ref_find_any(const char *hay, size_t len, const struct strview *needles, int k, int *which) {
+	for (size_t i = 0; i < len; ++i) {
+		for (int j = 0; j < k; ++j) {
+			if (needles[j].len <= len - i && memcmp(hay + i, needles[j].ptr, needles[j].len) == 0) {
+				*which = j;
+				return hay + i;
+			}
+		}
+	}
+	return NULL;
+}
+
+void test_mismatch() {
+	char a[300], b[300];
+	for (int i = 0; i < 300; ++i) {
+		a[i] = b[i] = 'a' + i % 26;
+	}
+	for (size_t n = 0; n <= 300; n += 7) {
+		assert(simd_mismatch(a, b, n) == n);
+		assert(simd_memeq(a, b, n));
+		for (size_t pos = 0; pos < n; pos += 5) {
+			b[pos] ^= 0x80;
+			assert(simd_mismatch(a, b, n) == ref_mismatch(a, b, n) && simd_mismatch(a, b, n) == pos);
+			assert(!simd_memeq(a, b, n));
+			b[pos] ^= 0x80;
+		}
+	}
+}
+
+void test_count() {
+	// more than 255 blocks to cover the per-lane counter flush
+	enum { N = 20000 };
+	char *buf = (char*) malloc(N);
+	uint64_t state = 1;
+	size_t expect = 0;
+	for (int i = 0; i < N; ++i) {
+		state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+		buf[i] = (state >> 60) < 3 ? '\0' : 'x';
+	}
+	for (size_t n = 0; n <= N; n = n < 100 ? n + 1 : n * 3) {
+		expect = 0;
+		for (size_t i = 0; i < n; ++i) {
+			expect += buf[i] == '\0';
+		}
+		assert(simd_count_strings(buf, n) == expect);
+		assert(simd_count_byte(buf, n, 'x') == n - expect);
+	}
+	memset(buf, 0, N);
+	assert(simd_count_strings(buf, N) == N);
+	free(buf);
+}
+
+void test_find_any() {
+	static const char strtab[] = "\0sum\0sumsin\0_start\0main\0.text.main\0sin\0printf\0";
+	size_t len = sizeof(strtab) - 1;
+	int which = -1;
+	// whole names: "sin" must not match inside "sumsin"
+	struct strview names[] = {strview_create("\0sin\0", 5), strview_create("\0printf\0", 8)};
+	assert(simd_find_any(strtab, len, names, 2, &which) == strtab + 34 && which == 0);
+	// substrings, the first occurrence wins
+	struct strview subs[] = {strview_from_cstr("main"), strview_from_cstr("sin")};
+	assert(simd_find_any(strtab, len, subs, 2, &which) == strtab + 8 && which == 1);
+	struct strview missing[] = {strview_from_cstr("exit")};
+	assert(simd_find_any(strtab, len, missing, 1, &which) == NULL);
+	// longer than the haystack
+	assert(simd_find_any("ab", 2, missing, 1, &which) == NULL);
+
+	// random haystacks over a small alphabet so there are many candidates
+	char hay[500];
+	uint64_t state = 7;
+	for (int round = 0; round < 200; ++round) {
+		size_t n = round * 5 % 500;
+		for (size_t i = 0; i < n; ++i) {
+			state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+			hay[i] = 'a' + (state >> 61);
+		}
+		char nbuf[SIMD_FIND_MAX_NEEDLES][40];
+		struct strview needles[SIMD_FIND_MAX_NEEDLES];
+		int k = 1 + round % SIMD_FIND_MAX_NEEDLES;
+		for (int j = 0; j < k; ++j) {
+			state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+			int nlen = 1 + (state >> 59) % 6 + (j == 0 ? 30 : 0);
+			for (int c = 0; c < nlen; ++c) {
+				state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+				nbuf[j][c] = 'a' + (state >> 61);
+			}
+			needles[j] = strview_create(nbuf[j], nlen);
+		}
+		int w1 = -1, w2 = -1;
+		const char *got = simd_find_any(hay, n, needles, k, &w1);
+		const char *expect = ref_find_any(hay, n, needles, k, &w2);
+		assert(got == expect && (!got || w1 == w2));
+	}
+}
+
+int main(void) {
+	printf("detected %s\n", simd_level_name(simd_str_level()));
+	for (int level = SIMD_SCALAR; level <= SIMD_AVX2; ++level) {
+		enum simd_level used = simd_str_set_level((enum simd_level) level);
+		printf("testing %s\n", simd_level_name(used));
+		test_mismatch();
+		test_count();
+		test_find_any();
+	}
+	printf("PASS!\n");
+	return 0;
+}
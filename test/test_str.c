@@ -58,12 +58,92 @@ void test_move() {
 	// no need to free s any more
 }
 
+void test_inline() {
+	char storage[8];
+	struct str s = STR_CREATE_INLINE(storage);
+	assert(s.buf == storage && s.capacity == 8);
+	str_concat(&s, "hello");
+	assert(s.buf == storage);
+	str_concat(&s, "world");
+	// spilled to the heap
+	assert(s.buf != storage);
+	assert(s.len == 12);
+	assert(strcmp(s.buf, "hello") == 0 && strcmp(s.buf + 6, "world") == 0);
+	str_free(&s);
+
+	s = STR_CREATE_INLINE(storage);
+	str_concat(&s, "abc");
+	struct str s2 = str_move(&s);
+	assert(s2.buf == storage && strcmp(s2.buf, "abc") == 0);
+	// no heap memory but freeing is fine
+	str_free(&s2);
+}
+
+void test_write_bytes_and_fill() {
+	struct str s = str_create(0);
+	assert(str_write_bytes(&s, "abc", 3) == 0);
+	assert(str_write_bytes(&s, "", 0) == 3);
+	assert(str_fill(&s, 100, 'x') == 3);
+	assert(s.len == 103);
+	assert(memcmp(s.buf, "abcx", 4) == 0 && s.buf[102] == 'x');
+	str_free(&s);
+
+	char storage[4];
+	s = STR_CREATE_INLINE(storage);
+	str_write_bytes(&s, "hello world", 12);
+	assert(s.buf != storage && strcmp(s.buf, "hello world") == 0);
+	str_free(&s);
+}
+
+void test_reserve() {
+	struct str s = str_create(0);
+	str_reserve(&s, 100);
+	assert(s.capacity == 100);
+	char *buf = s.buf;
+	str_fill(&s, 100, 'a');
+	assert(s.buf == buf);
+	str_reserve(&s, 10);
+	assert(s.capacity == 100);
+	str_free(&s);
+}
+
+void test_put() {
+	struct str s = str_create(0);
+	assert(str_put_u8(&s, 0xb8) == 0);
+	assert(str_put_u32(&s, 0x12345678) == 1);
+	assert(str_put_u16(&s, 0x80cd) == 5);
+	uint8_t expected[] = {0xb8, 0x78, 0x56, 0x34, 0x12, 0xcd, 0x80};
+	assert(s.len == sizeof(expected));
+	assert(memcmp(s.buf, expected, sizeof(expected)) == 0);
+	str_free(&s);
+}
+
+void test_appendf() {
+	struct str s = str_create(0);
+	assert(str_appendf(&s, "%s.%d", ".text", 1) == 0);
+	assert(s.len == 7 && memcmp(s.buf, ".text.1", 7) == 0);
+	// grows in the middle of formatting
+	char longname[100];
+	memset(longname, 'n', 99);
+	longname[99] = '\0';
+	assert(str_appendf(&s, ",%s", longname) == 7);
+	assert(s.len == 107 && s.buf[106] == 'n');
+	// the trailing '\0' is there but not counted
+	assert(s.buf[107] == '\0');
+	str_free(&s);
+}
+
 int main(void) {
 	test_no_malloc_for_capa_0();
 	test_append();
 	test_concat();
 	test_nappend();
 	test_move();
+	test_inline();
+	test_write_bytes_and_fill();
+	test_reserve();
+	test_put();
+	test_appendf();
 	printf("PASS!\n");
 	return 0;
 }
@@ -0,0 +1,80 @@
+#include "scom/strtab.h"
+#include <assert.h>
+#include <stdio.h>
+
+static const char* str_at(struct strtab* st, uint32_t id) {
+	return st->buf.buf + strtab_offset(st, id);
+}
+
+void test_empty() {
+	struct strtab st = strtab_create();
+	strtab_finalize(&st);
+	// just the leading '\0'
+	assert(strtab_size(&st) == 1 && st.buf.buf[0] == '\0');
+	strtab_free(&st);
+}
+
+void test_dedup_and_tail_merge() {
+	struct strtab st = strtab_create();
+	uint32_t text = strtab_add(&st, ".text");
+	uint32_t rel_text = strtab_add(&st, ".rel.text");
+	uint32_t text2 = strtab_add(&st, ".text");
+	uint32_t data = strtab_add(&st, ".data");
+	uint32_t name = strtab_add(&st, "name");
+	uint32_t sh_name = strtab_add(&st, "sh_name");
+	uint32_t empty = strtab_add(&st, "");
+	assert(text == text2);
+	strtab_finalize(&st);
+
+	assert(strcmp(str_at(&st, text), ".text") == 0);
+	assert(strcmp(str_at(&st, rel_text), ".rel.text") == 0);
+	assert(strcmp(str_at(&st, data), ".data") == 0);
+	assert(strcmp(str_at(&st, name), "name") == 0);
+	assert(strcmp(str_at(&st, sh_name), "sh_name") == 0);
+	assert(strtab_offset(&st, empty) == 0);
+	// .text and name live inside .rel.text and sh_name
+	assert(strtab_offset(&st, text) == strtab_offset(&st, rel_text) + 4);
+	assert(strtab_offset(&st, name) == strtab_offset(&st, sh_name) + 3);
+	assert(strtab_size(&st) == 1 + sizeof(".rel.text") + sizeof(".data") + sizeof("sh_name"));
+	strtab_free(&st);
+}
+
+void test_many() {
+	struct strtab st = strtab_create();
+	char buf[32];
+	uint32_t ids[3000];
+	// a chain of suffixes plus unrelated names
+	for (int i = 0; i < 1000; ++i) {
+		snprintf(buf, sizeof(buf), "_Z%dfoo", i);
+		ids[i] = strtab_add(&st, buf);
+		snprintf(buf, sizeof(buf), "%dfoo", i);
+		ids[1000 + i] = strtab_add(&st, buf);
+		snprintf(buf, sizeof(buf), "bar%d", i);
+		ids[2000 + i] = strtab_add(&st, buf);
+	}
+	strtab_finalize(&st);
+	for (int i = 0; i < 1000; ++i) {
+		snprintf(buf, sizeof(buf), "_Z%dfoo", i);
+		assert(strcmp(str_at(&st, ids[i]), buf) == 0);
+		snprintf(buf, sizeof(buf), "%dfoo", i);
+		assert(strcmp(str_at(&st, ids[1000 + i]), buf) == 0);
+		snprintf(buf, sizeof(buf), "bar%d", i);
+		assert(strcmp(str_at(&st, ids[2000 + i]), buf) == 0);
+	}
+	// every "%dfoo" is merged into a longer string, e.g. its "_Z%dfoo"
+	int expected_size = 1;
+	for (int i = 0; i < 1000; ++i) {
+		expected_size += snprintf(buf, sizeof(buf), "_Z%dfoo", i) + 1;
+		expected_size += snprintf(buf, sizeof(buf), "bar%d", i) + 1;
+	}
+	assert(strtab_size(&st) == expected_size);
+	strtab_free(&st);
+}
+
+int main(void) {
+	test_empty();
+	test_dedup_and_tail_merge();
+	test_many();
+	printf("PASS!\n");
+	return 0;
+}
@@ -0,0 +1,57 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include "scom/strview.h"
+#include "scom/dict.h"
+
+void test_eq_cmp() {
+	const char *text = "abcabd";
+	struct strview abc = strview_create(text, 3);
+	struct strview abd = strview_create(text + 3, 3);
+	assert(strview_eq(abc, strview_from_cstr("abc")));
+	assert(!strview_eq(abc, abd));
+	assert(!strview_eq(abc, strview_create(text, 2)));
+	assert(strview_eq_cstr(abc, "abc"));
+	assert(!strview_eq_cstr(abc, "ab"));
+	assert(!strview_eq_cstr(abc, "abca"));
+	assert(strview_eq_cstr(strview_create(text, 0), ""));
+	// a '\0' inside the view must not end the comparison early, nor make it
+	// read past the end of the shorter C string
+	char *shorter = strdup("ab");
+	assert(!strview_eq_cstr(strview_create("ab\0cd", 5), shorter));
+	free(shorter);
+
+	assert(strview_cmp(abc, abd) < 0);
+	assert(strview_cmp(abd, abc) > 0);
+	assert(strview_cmp(abc, strview_from_cstr("abc")) == 0);
+	// a prefix sorts first
+	assert(strview_cmp(strview_create(text, 2), abc) < 0);
+	assert(strview_cmp(abc, strview_create(text, 2)) > 0);
+}
+
+void test_prefix_suffix() {
+	struct strview name = strview_from_cstr(".rel.text.main");
+	assert(strview_startswith(name, strview_from_cstr(".rel.")));
+	assert(!strview_startswith(name, strview_from_cstr(".rela.")));
+	assert(strview_endswith(name, strview_from_cstr(".main")));
+	assert(!strview_endswith(name, strview_from_cstr("xmain")));
+	assert(strview_startswith(name, strview_create("", 0)));
+	assert(!strview_startswith(strview_from_cstr(".rel"), name));
+	assert(!strview_endswith(strview_from_cstr("main"), name));
+}
+
+void test_hash() {
+	// a view hashes like the C string with the same bytes
+	const char *text = "foo.bar";
+	assert(strview_hash(strview_create(text, 3)) == str_hash_fn("foo"));
+	assert(strview_hash(strview_create(text + 4, 3)) == str_hash_fn("bar"));
+	assert(strview_hash_seeded(strview_create(text, 3), 42) == str_hash_seeded_fn("foo", 42));
+}
+
+int main(void) {
+	test_eq_cmp();
+	test_prefix_suffix();
+	test_hash();
+	printf("PASS!\n");
+	return 0;
+}
@@ -0,0 +1,80 @@
+#include "scom/threadpool.h"
+#include <assert.h>
+#include <stdio.h>
+
+static void visit(void *ctx, void *item, size_t idx) {
+	int *counts = (int*) ctx;
+	assert(*(int*) item == (int) idx);
+	__atomic_add_fetch(&counts[idx], 1, __ATOMIC_RELAXED);
+}
+
+static struct vec make_ints(int n) {
+	struct vec vec = vec_create(sizeof(int));
+	for (int i = 0; i < n; ++i) {
+		vec_append(&vec, &i);
+	}
+	return vec;
+}
+
+void test_parallel_for() {
+	int nthreads[] = {1, 2, 4, 8};
+	size_t grains[] = {0, 1, 7, 1000, 1000000};
+	int n = 100000;
+	struct vec ints = make_ints(n);
+	int *counts = (int*) malloc(sizeof(int) * n);
+	for (int t = 0; t < sizeof(nthreads) / sizeof(*nthreads); ++t) {
+		struct threadpool *pool = threadpool_create(nthreads[t]);
+		for (int g = 0; g < sizeof(grains) / sizeof(*grains); ++g) {
+			memset(counts, 0, sizeof(int) * n);
+			parallel_for(pool, &ints, visit, counts, grains[g]);
+			// every item exactly once
+			for (int i = 0; i < n; ++i) {
+				assert(counts[i] == 1);
+			}
+		}
+		threadpool_free(pool);
+	}
+	free(counts);
+	vec_free(&ints);
+}
+
+static void square(void *ctx, const void *in, void *out, size_t idx) {
+	int v = *(const int*) in;
+	*(int64_t*) out = (int64_t) v * v;
+}
+
+void test_parallel_map() {
+	struct threadpool *pool = threadpool_create(4);
+	struct vec ints = make_ints(10000);
+	struct vec squares = vec_create(sizeof(int64_t));
+	parallel_map(pool, &ints, &squares, square, NULL, 16);
+	assert(squares.len == 10000);
+	for (int i = 0; i < 10000; ++i) {
+		assert(*(int64_t*) vec_get_item(&squares, i) == (int64_t) i * i);
+	}
+	vec_free(&squares);
+	vec_free(&ints);
+	threadpool_free(pool);
+}
+
+static void add_range(void *ctx, size_t begin, size_t end) {
+	__atomic_add_fetch((size_t*) ctx, end - begin, __ATOMIC_RELAXED);
+}
+
+void test_many_short_loops() {
+	struct threadpool *pool = threadpool_create(4);
+	for (size_t n = 0; n < 2000; ++n) {
+		size_t total = 0;
+		threadpool_run(pool, n, add_range, &total, 3);
+		assert(total == n);
+	}
+	threadpool_free(pool);
+}
+
+int main(void) {
+	test_parallel_for();
+	test_parallel_map();
+	test_many_short_loops();
+	printf("PASS!\n");
+	return 0;
+}
@@ -13,6 +13,8 @@ void test_endian_swap() {
 void test_string_prefix_suffix() {
 	assert(startswith("abcd", "abc"));
 	assert(!startswith("abcd", "abd"));
+	assert(!startswith("ab", "abc"));
+	assert(startswith("ab", ""));
 	assert(endswith("abcd", "bcd"));
 	assert(!endswith("abcd", "acd"));
 }
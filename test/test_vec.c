@@ -30,10 +30,133 @@ void test_csv() {
 	vec_free(&vec);
 }
 
+static int *int_data(struct vec* vec) {
+	return (int*) vec->data;
+}
+
+void test_reserve_and_shrink() {
+	struct vec vec = vec_create(sizeof(int));
+	vec_reserve(&vec, 100);
+	assert(vec.capacity == 100 && vec.len == 0);
+	void *data = vec.data;
+	for (int i = 0; i < 100; ++i) {
+		vec_append(&vec, &i);
+	}
+	// no reallocation
+	assert(vec.data == data && vec.capacity == 100);
+	vec_reserve(&vec, 10);
+	assert(vec.capacity == 100);
+
+	vec_resize(&vec, 10);
+	vec_shrink_to_fit(&vec);
+	assert(vec.capacity == 10 && vec.len == 10);
+	assert(int_data(&vec)[9] == 9);
+	vec_resize(&vec, 0);
+	vec_shrink_to_fit(&vec);
+	assert(vec.capacity == 0 && vec.data == NULL);
+	vec_free(&vec);
+}
+
+void test_extend_resize() {
+	struct vec vec = vec_create(sizeof(int));
+	int items[1000];
+	for (int i = 0; i < 1000; ++i) {
+		items[i] = i;
+	}
+	vec_extend(&vec, items, 0);
+	assert(vec.len == 0);
+	vec_extend(&vec, items, 1000);
+	vec_extend(&vec, items, 500);
+	assert(vec.len == 1500);
+	assert(vec.capacity >= 1500);
+	assert(int_data(&vec)[999] == 999 && int_data(&vec)[1000] == 0 && int_data(&vec)[1499] == 499);
+
+	vec_resize(&vec, 2000);
+	assert(vec.len == 2000);
+	assert(int_data(&vec)[1499] == 499 && int_data(&vec)[1500] == 0 && int_data(&vec)[1999] == 0);
+	vec_resize(&vec, 3);
+	assert(vec.len == 3 && int_data(&vec)[2] == 2);
+	vec_free(&vec);
+}
+
+void test_insert_erase_range() {
+	struct vec vec = vec_create(sizeof(int));
+	int items[] = {0, 1, 2, 3, 4, 5};
+	vec_extend(&vec, items, 2); // 0 1
+	vec_insert_range(&vec, 2, items + 4, 2); // 0 1 4 5
+	vec_insert_range(&vec, 2, items + 2, 2); // 0 1 2 3 4 5
+	vec_insert_range(&vec, 0, items, 0);
+	assert(vec.len == 6);
+	for (int i = 0; i < 6; ++i) {
+		assert(int_data(&vec)[i] == i);
+	}
+	vec_erase_range(&vec, 1, 3); // 0 4 5
+	assert(vec.len == 3);
+	assert(int_data(&vec)[0] == 0 && int_data(&vec)[1] == 4 && int_data(&vec)[2] == 5);
+	vec_erase_range(&vec, 3, 0);
+	vec_erase_range(&vec, 0, 3);
+	assert(vec.len == 0);
+	vec_free(&vec);
+
+	// owned items are freed when erased or dropped by resize
+	struct vec strs = vec_create_from_csv("a,b,c,d,e");
+	vec_erase_range(&strs, 1, 2);
+	assert(strs.len == 3);
+	assert(strcmp(*(char**) vec_get_item(&strs, 1), "d") == 0);
+	vec_resize(&strs, 1);
+	assert(strcmp(*(char**) vec_get_item(&strs, 0), "a") == 0);
+	vec_free(&strs);
+}
+
+void test_inline() {
+	int storage[4];
+	struct vec vec = VEC_CREATE_INLINE(sizeof(int), storage);
+	assert(vec.data == storage && vec.capacity == 4);
+	for (int i = 0; i < 4; ++i) {
+		vec_append(&vec, &i);
+	}
+	assert(vec.data == storage);
+	vec_shrink_to_fit(&vec);
+	assert(vec.data == storage);
+	int i = 4;
+	vec_append(&vec, &i);
+	// spilled to the heap
+	assert(vec.data != storage && !vec.data_inline);
+	assert(vec.len == 5);
+	for (int i = 0; i < 5; ++i) {
+		assert(int_data(&vec)[i] == i);
+	}
+	vec_free(&vec);
+
+	// owned items in inline storage are still freed
+	char *strs[2];
+	vec = VEC_CREATE_INLINE(sizeof(char*), strs);
+	vec.should_free_each_item = true;
+	char *item = lenstrdup("abc", 3);
+	vec_append(&vec, &item);
+	vec_free(&vec);
+}
+
+void test_strview_find() {
+	const char *text = "foobarfoo";
+	struct vec vec = vec_create(sizeof(struct strview));
+	struct strview views[] = {strview_create(text, 3), strview_create(text + 3, 3), strview_create(text, 6)};
+	vec_extend(&vec, views, 3);
+	assert(vec_strview_find(&vec, strview_create(text + 6, 3)) == 0);
+	assert(vec_strview_find(&vec, strview_from_cstr("foobar")) == 2);
+	assert(vec_strview_find(&vec, strview_from_cstr("fo")) == -1);
+	vec_free(&vec);
+}
+
 int main(void) {
 	test_nomalloc_in_creator();
 	test_read_back();
 	test_csv();
+	test_reserve_and_shrink();
+	test_extend_resize();
+	test_insert_erase_range();
+	test_inline();
+	test_strview_find();
 	printf("PASS!\n");
 	return 0;
 }
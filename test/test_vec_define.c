@@ -0,0 +1,81 @@
+#include "scom/vec_define.h"
+#include <assert.h>
+
+struct point {
+	int x, y;
+	char tag[12];
+};
+
+VEC_DEFINE(int_vec, int)
+VEC_DEFINE(point_vec, struct point)
+VEC_DEFINE(str_vec, char*)
+
+void test_push_at() {
+	struct vec vec = int_vec_create();
+	assert(vec.data == NULL);
+	for (int i = 0; i < 1000; ++i) {
+		int_vec_push(&vec, i * 2);
+	}
+	assert(vec.len == 1000);
+	for (int i = 0; i < 1000; ++i) {
+		assert(*int_vec_at(&vec, i) == i * 2);
+		assert(*int_vec_at_unchecked(&vec, i) == i * 2);
+		assert(int_vec_data(&vec)[i] == i * 2);
+	}
+	*int_vec_at(&vec, 3) = -1;
+	assert(int_vec_data(&vec)[3] == -1);
+	assert(int_vec_pop(&vec) == 1998);
+	assert(vec.len == 999);
+
+	int sum = 0, cnt = 0;
+	VEC_DEFINE_FOREACH(int_vec, &vec, item) {
+		sum += *item;
+		++cnt;
+	}
+	assert(cnt == 999);
+	assert(sum == 999 * 998 - 6 - 1);
+	vec_free(&vec);
+}
+
+void test_struct_item() {
+	struct vec vec = point_vec_create();
+	for (int i = 0; i < 100; ++i) {
+		struct point pt = {i, -i};
+		snprintf(pt.tag, sizeof(pt.tag), "pt%d", i);
+		point_vec_push(&vec, pt);
+	}
+	assert(point_vec_at(&vec, 42)->y == -42);
+	assert(strcmp(point_vec_at(&vec, 99)->tag, "pt99") == 0);
+	vec_free(&vec);
+}
+
+// the typed functions and the generic ones work on the same struct vec
+void test_mix_with_vec() {
+	struct vec vec = vec_create(sizeof(int));
+	for (int i = 0; i < 10; ++i) {
+		if (i % 2) {
+			vec_append(&vec, &i);
+		} else {
+			int_vec_push(&vec, i);
+		}
+	}
+	VEC_FOREACH_I(&vec, int, item_ptr, i) {
+		assert(item_ptr == int_vec_at(&vec, i));
+		assert(*item_ptr == i);
+	}
+	vec_free(&vec);
+
+	struct vec strs = vec_create_from_csv("hello,world");
+	assert(strcmp(*str_vec_at(&strs, 1), "world") == 0);
+	str_vec_push(&strs, lenstrdup("again", 5));
+	assert(strcmp(*(char**) vec_get_item(&strs, 2), "again") == 0);
+	vec_free(&strs);
+}
+
+int main(void) {
+	test_push_at();
+	test_struct_item();
+	test_mix_with_vec();
+	printf("PASS!\n");
+	return 0;
+}